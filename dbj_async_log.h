@@ -0,0 +1,706 @@
+#ifndef DBJ_ASYNC_LOG_INC
+#define DBJ_ASYNC_LOG_INC
+
+/*
+(c) 2021 by dbj.org   -- LICENSE DBJ -- https://dbj.org/license_dbj/
+
+dbj asynchronous log backend
+
+fprintf(stderr, ...) on each DBJ_PRINT stalls the caller on the I/O and
+makes all the printing threads wait on the one stdio lock. here the
+caller formats into its own queue and goes on. the background writer
+drains all the queues into one buffer and writes it with one write(2).
+
+	// define before including dbj_debug.h, DBJ_PRINT then goes here
+	#define DBJ_ASYNC_PRINT
+
+	// or directly
+	dbj::async_log::print("%s -- %d\n", name_, value_);
+
+	// everything printed so far is written when this returns
+	dbj::async_log::flush();
+
+	// or the format pointer and the arguments are copied and
+	// formatted on the writer thread, the caller cost is about a memcpy
+	dbj::async_log::print_deferred("%s -- %d\n", name_, value_);
+
+each thread has its own queue of DBJ_ASYNC_LOG_QUEUE bytes, the memory is
+bounded. when the writer can not keep up and the queue is full:
+
+	policy::drop   the message is lost and counted, the caller never waits
+	policy::block  the caller waits for the writer
+
+block is the default, DBJ_PRINT never lost the output and it does not
+now. DBJ_ASYNC_LOG_DROP defined makes drop the default, set_policy()
+changes it at runtime. dropped messages are reported in the output.
+once the writer is stopped at exit, the blocked callers drop.
+
+the order is kept per thread, not between the threads.
+
+flushed and stopped at exit. dbj::terror() flushes before exiting.
+queues of the threads which are gone are reused by the new threads.
+
+deferred formatting:
+
+	DBJ_ASYNC_PRINT_DEFERRED defined, and DBJ_PRINT is print_deferred()
+
+	the format string is not copied, just the pointer, thus it must be the
+	string literal or live as long as the program. the arguments must be
+	trivially copyable, that is checked at compile time. char and wchar_t
+	strings are copied, the text not the pointer, thus %p of them prints
+	the address of the copy. messages bigger than DBJ_ASYNC_LOG_LINE are
+	formatted on the caller, as print() does.
+
+Note: this header does not depend on the rest of dbj, just on the
+dbj_nano_mutex.h
+*/
+
+#ifdef __clang__
+#pragma clang system_header
+#endif // __clang__
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+
+#include "dbj_nano_mutex.h"
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <cerrno>
+#include <unistd.h>
+#endif
+
+// bytes per thread queue, must be the power of two
+#ifndef DBJ_ASYNC_LOG_QUEUE
+#define DBJ_ASYNC_LOG_QUEUE (1 << 16)
+#endif
+
+// longest message, longer are cut
+#ifndef DBJ_ASYNC_LOG_LINE
+#define DBJ_ASYNC_LOG_LINE 1024
+#endif
+
+// writer buffer, one write(2) at most this big
+#ifndef DBJ_ASYNC_LOG_BATCH
+#define DBJ_ASYNC_LOG_BATCH (1 << 16)
+#endif
+
+// the writer wakes up at least this often
+#ifndef DBJ_ASYNC_LOG_PERIOD_MS
+#define DBJ_ASYNC_LOG_PERIOD_MS 5
+#endif
+
+// the output file descriptor, stderr
+#ifndef DBJ_ASYNC_LOG_FD
+#define DBJ_ASYNC_LOG_FD 2
+#endif
+
+namespace dbj::async_log
+{
+	static_assert((DBJ_ASYNC_LOG_QUEUE & (DBJ_ASYNC_LOG_QUEUE - 1)) == 0,
+				  "DBJ_ASYNC_LOG_QUEUE must be the power of two");
+	static_assert(DBJ_ASYNC_LOG_LINE + 64 <= DBJ_ASYNC_LOG_QUEUE / 2,
+				  "DBJ_ASYNC_LOG_LINE must fit in the half of DBJ_ASYNC_LOG_QUEUE");
+
+	enum class policy : unsigned
+	{
+		drop,
+		block
+	};
+
+	// each message in the queue: header, then the payload
+	struct message_header final
+	{
+		std::uint32_t size{};
+		std::uint32_t kind{};
+	};
+
+	enum : std::uint32_t
+	{
+		kind_text = 0,
+		// formatter, format, packed arguments
+		kind_deferred = 1
+	};
+
+	/*
+	single producer, the owner thread
+	single consumer, whoever holds the drain lock
+	*/
+	struct queue final
+	{
+		static constexpr std::uint64_t capacity = DBJ_ASYNC_LOG_QUEUE;
+		static constexpr std::uint64_t mask = capacity - 1;
+
+		alignas(DBJ_NANO_CACHE_LINE) std::atomic<std::uint64_t> head{0};
+		alignas(DBJ_NANO_CACHE_LINE) std::atomic<std::uint64_t> tail{0};
+
+		std::atomic<bool> owned{false};
+		queue* next{};
+
+		alignas(DBJ_NANO_CACHE_LINE) unsigned char bytes[capacity]{};
+
+		std::uint64_t free_space() const noexcept
+		{
+			return capacity - (head.load(std::memory_order_relaxed) - tail.load(std::memory_order_acquire));
+		}
+
+		// the ring might wrap in the middle
+		void write_at(std::uint64_t at_, const void* data_, std::size_t size_) noexcept
+		{
+			const std::size_t offset_ = std::size_t(at_ & mask);
+			const std::size_t first_ = size_ < capacity - offset_ ? size_ : std::size_t(capacity - offset_);
+			std::memcpy(bytes + offset_, data_, first_);
+			if (first_ < size_)
+				std::memcpy(bytes, static_cast<const unsigned char*>(data_) + first_, size_ - first_);
+		}
+
+		void read_at(std::uint64_t at_, void* data_, std::size_t size_) const noexcept
+		{
+			const std::size_t offset_ = std::size_t(at_ & mask);
+			const std::size_t first_ = size_ < capacity - offset_ ? size_ : std::size_t(capacity - offset_);
+			std::memcpy(data_, bytes + offset_, first_);
+			if (first_ < size_)
+				std::memcpy(static_cast<unsigned char*>(data_) + first_, bytes, size_ - first_);
+		}
+
+		// the caller checked the free space
+		void push(std::uint32_t kind_, const void* payload_, std::uint32_t size_) noexcept
+		{
+			const std::uint64_t head_ = head.load(std::memory_order_relaxed);
+			const message_header header_{size_, kind_};
+			write_at(head_, &header_, sizeof(header_));
+			write_at(head_ + sizeof(header_), payload_, size_);
+			head.store(head_ + sizeof(header_) + size_, std::memory_order_release);
+		}
+	};
+
+	struct state_type final
+	{
+		std::atomic<queue*> queues{nullptr};
+		std::atomic<unsigned> policy{
+#ifdef DBJ_ASYNC_LOG_DROP
+			unsigned(policy::drop)
+#else
+			unsigned(policy::block)
+#endif
+		};
+		std::atomic<std::uint64_t> dropped{0};
+
+		// the writer thread
+		std::atomic<bool> started{false};
+		std::atomic<std::uint32_t> signal{0};
+		std::atomic<bool> stop{false};
+		std::thread writer;
+		nano::mutex start_lock;
+
+		// the consumer side of all the queues, and the batch
+		nano::mutex drain_lock;
+		std::uint64_t reported_dropped{};
+		// the deferred payload is copied here, it might wrap in the queue
+		unsigned char payload[DBJ_ASYNC_LOG_LINE]{};
+		std::size_t batch_size{};
+		char batch[DBJ_ASYNC_LOG_BATCH]{};
+	};
+
+	inline state_type& state() noexcept
+	{
+		static state_type state_{};
+		return state_;
+	}
+
+	inline void set_policy(policy policy_) noexcept
+	{
+		state().policy.store(unsigned(policy_), std::memory_order_relaxed);
+	}
+
+	// messages lost so far, the queues were full
+	inline std::uint64_t dropped() noexcept
+	{
+		return state().dropped.load(std::memory_order_relaxed);
+	}
+
+	/*
+	the arguments of the deferred message, packed without the alignment
+	the strings are the length, the chars and the zero
+	*/
+	namespace deferred
+	{
+		template <typename T>
+		struct argument final
+		{
+			static_assert(std::is_trivially_copyable_v<T>,
+						  "dbj::async_log deferred arguments must be trivially copyable");
+
+			static std::size_t size(T const&) noexcept { return sizeof(T); }
+
+			static void pack(unsigned char*& at_, T const& value_) noexcept
+			{
+				std::memcpy(at_, &value_, sizeof(T));
+				at_ += sizeof(T);
+			}
+
+			static T unpack(const unsigned char*& at_) noexcept
+			{
+				T value_;
+				std::memcpy(&value_, at_, sizeof(T));
+				at_ += sizeof(T);
+				return value_;
+			}
+		};
+
+		template <typename C>
+		struct string_argument
+		{
+			static std::uint32_t length(const C* text_) noexcept
+			{
+				if (!text_)
+					return 0;
+				std::uint32_t length_{};
+				while (text_[length_] && length_ < DBJ_ASYNC_LOG_LINE)
+					++length_;
+				return length_;
+			}
+
+			static std::size_t size(const C* text_) noexcept
+			{
+				return sizeof(std::uint32_t) + (length(text_) + 1) * sizeof(C);
+			}
+
+			static void pack(unsigned char*& at_, const C* text_) noexcept
+			{
+				const std::uint32_t length_ = length(text_);
+				std::memcpy(at_, &length_, sizeof(length_));
+				at_ += sizeof(length_);
+				if (length_)
+					std::memcpy(at_, text_, length_ * sizeof(C));
+				at_ += length_ * sizeof(C);
+				const C zero_{};
+				std::memcpy(at_, &zero_, sizeof(C));
+				at_ += sizeof(C);
+			}
+
+			// DBJ NOTE: points into the payload copy, valid while formatting
+			static const C* unpack(const unsigned char*& at_) noexcept
+			{
+				std::uint32_t length_{};
+				std::memcpy(&length_, at_, sizeof(length_));
+				at_ += sizeof(length_);
+				const C* text_ = reinterpret_cast<const C*>(at_);
+				at_ += (length_ + 1) * sizeof(C);
+				return text_;
+			}
+		};
+
+		template <>
+		struct argument<const char*> final : string_argument<char>
+		{
+		};
+		template <>
+		struct argument<char*> final : string_argument<char>
+		{
+		};
+		template <>
+		struct argument<const wchar_t*> final : string_argument<wchar_t>
+		{
+		};
+		template <>
+		struct argument<wchar_t*> final : string_argument<wchar_t>
+		{
+		};
+
+		// formats into the output, returns what snprintf returns
+		using formatter = int (*)(char* output_, std::size_t size_, const char* format_,
+								  const unsigned char* arguments_) noexcept;
+
+		template <typename... A>
+		inline int format(char* output_, std::size_t size_, const char* format_,
+						  const unsigned char* arguments_) noexcept
+		{
+			// DBJ NOTE: the braced init list is evaluated left to right
+			const std::tuple<decltype(argument<A>::unpack(arguments_))...> values_{
+				argument<A>::unpack(arguments_)...};
+			(void)arguments_;
+			return std::apply([&](auto... value_) { return std::snprintf(output_, size_, format_, value_...); },
+							  values_);
+		}
+
+		// the payload: formatter, format, arguments
+		template <typename... A>
+		inline std::size_t payload_size(A const&... args_) noexcept
+		{
+			return sizeof(formatter) + sizeof(const char*) + (std::size_t{0} + ... + argument<A>::size(args_));
+		}
+
+		template <typename... A>
+		inline void pack(unsigned char* at_, const char* format_, A const&... args_) noexcept
+		{
+			const formatter formatter_ = &format<A...>;
+			std::memcpy(at_, &formatter_, sizeof(formatter_));
+			at_ += sizeof(formatter_);
+			std::memcpy(at_, &format_, sizeof(format_));
+			at_ += sizeof(format_);
+			(argument<A>::pack(at_, args_), ...);
+		}
+	} // namespace deferred
+
+	namespace detail
+	{
+		inline void write_all(const char* data_, std::size_t size_) noexcept
+		{
+			while (size_ > 0)
+			{
+#ifdef _WIN32
+				const int written_ = ::_write(DBJ_ASYNC_LOG_FD, data_, unsigned(size_));
+#else
+				const ssize_t written_ = ::write(DBJ_ASYNC_LOG_FD, data_, size_);
+				if (written_ < 0 && errno == EINTR)
+					continue;
+#endif
+				// DBJ NOTE: nowhere to report it, the log is the reporting
+				if (written_ <= 0)
+					return;
+				data_ += written_;
+				size_ -= std::size_t(written_);
+			}
+		}
+
+		// under the drain lock
+		inline void batch_flush(state_type& state_) noexcept
+		{
+			write_all(state_.batch, state_.batch_size);
+			state_.batch_size = 0;
+		}
+
+		// under the drain lock
+		inline void batch_append(state_type& state_, const char* data_, std::size_t size_) noexcept
+		{
+			if (state_.batch_size + size_ > sizeof(state_.batch))
+				batch_flush(state_);
+			std::memcpy(state_.batch + state_.batch_size, data_, size_);
+			state_.batch_size += size_;
+		}
+
+		/*
+		under the drain lock
+		the message is copied out of the queue into the batch
+		*/
+		inline void consume(state_type& state_, queue const& queue_, std::uint64_t at_,
+							message_header const& header_) noexcept
+		{
+			if (header_.kind == kind_deferred)
+			{
+				queue_.read_at(at_, state_.payload, header_.size);
+				deferred::formatter formatter_{};
+				const char* format_{};
+				std::memcpy(&formatter_, state_.payload, sizeof(formatter_));
+				std::memcpy(&format_, state_.payload + sizeof(formatter_), sizeof(format_));
+
+				if (state_.batch_size + DBJ_ASYNC_LOG_LINE > sizeof(state_.batch))
+					batch_flush(state_);
+				const int size_ = formatter_(state_.batch + state_.batch_size, DBJ_ASYNC_LOG_LINE, format_,
+											 state_.payload + sizeof(formatter_) + sizeof(format_));
+				if (size_ > 0)
+					state_.batch_size += std::size_t(size_) < DBJ_ASYNC_LOG_LINE ? std::size_t(size_) : DBJ_ASYNC_LOG_LINE - 1;
+				return;
+			}
+
+			if (state_.batch_size + header_.size > sizeof(state_.batch))
+				batch_flush(state_);
+			queue_.read_at(at_, state_.batch + state_.batch_size, header_.size);
+			state_.batch_size += header_.size;
+		}
+
+		// all the queues to the output, returns the bytes consumed
+		inline std::uint64_t drain(state_type& state_) noexcept
+		{
+			std::uint64_t consumed_{};
+			state_.drain_lock.lock();
+			for (queue* walker_ = state_.queues.load(std::memory_order_acquire); walker_; walker_ = walker_->next)
+			{
+				const std::uint64_t head_ = walker_->head.load(std::memory_order_acquire);
+				std::uint64_t tail_ = walker_->tail.load(std::memory_order_relaxed);
+				while (tail_ < head_)
+				{
+					message_header header_{};
+					walker_->read_at(tail_, &header_, sizeof(header_));
+					consume(state_, *walker_, tail_ + sizeof(header_), header_);
+					tail_ += sizeof(header_) + header_.size;
+				}
+				consumed_ += tail_ - walker_->tail.load(std::memory_order_relaxed);
+				walker_->tail.store(tail_, std::memory_order_release);
+			}
+
+			const std::uint64_t dropped_ = state_.dropped.load(std::memory_order_relaxed);
+			if (dropped_ != state_.reported_dropped)
+			{
+				char note_[96]{};
+				const int size_ = std::snprintf(note_, sizeof(note_), "\n[dbj async log: %llu messages dropped]\n",
+												(unsigned long long)(dropped_ - state_.reported_dropped));
+				state_.reported_dropped = dropped_;
+				if (size_ > 0)
+					batch_append(state_, note_, std::size_t(size_));
+			}
+
+			batch_flush(state_);
+			state_.drain_lock.unlock();
+			return consumed_;
+		}
+
+		inline void wake_writer(state_type& state_) noexcept
+		{
+			state_.signal.fetch_add(1, std::memory_order_release);
+			nano::futex_wake_one(&state_.signal);
+		}
+
+		inline void stop_writer() noexcept
+		{
+			state_type& state_ = state();
+			state_.start_lock.lock();
+			if (state_.writer.joinable())
+			{
+				state_.stop.store(true, std::memory_order_release);
+				wake_writer(state_);
+				state_.writer.join();
+			}
+			state_.start_lock.unlock();
+			drain(state_);
+		}
+
+		inline void start_writer(state_type& state_) noexcept
+		{
+			state_.start_lock.lock();
+			if (!state_.started.load(std::memory_order_relaxed))
+			{
+				state_.writer = std::thread([] {
+					state_type& state_ = state();
+					const std::chrono::nanoseconds period_ = std::chrono::milliseconds(DBJ_ASYNC_LOG_PERIOD_MS);
+					while (!state_.stop.load(std::memory_order_acquire))
+					{
+						const std::uint32_t seen_ = state_.signal.load(std::memory_order_acquire);
+						if (drain(state_) == 0)
+							nano::futex_wait_for(&state_.signal, seen_, period_);
+					}
+				});
+				std::atexit([] { stop_writer(); });
+				state_.started.store(true, std::memory_order_release);
+			}
+			state_.start_lock.unlock();
+		}
+
+		// takes the free queue or makes the new one, nullptr if out of memory
+		inline queue* acquire_queue() noexcept
+		{
+			state_type& state_ = state();
+			if (!state_.started.load(std::memory_order_acquire))
+				start_writer(state_);
+
+			for (queue* walker_ = state_.queues.load(std::memory_order_acquire); walker_; walker_ = walker_->next)
+			{
+				bool expected_ = false;
+				if (walker_->owned.compare_exchange_strong(expected_, true, std::memory_order_acquire))
+					return walker_;
+			}
+			queue* new_ = new (std::nothrow) queue{};
+			if (!new_)
+				return nullptr;
+			new_->owned.store(true, std::memory_order_relaxed);
+			new_->next = state_.queues.load(std::memory_order_relaxed);
+			while (!state_.queues.compare_exchange_weak(new_->next, new_, std::memory_order_release, std::memory_order_relaxed))
+			{
+			}
+			return new_;
+		}
+
+		// gives the queue back when the thread is gone
+		struct queue_holder final
+		{
+			queue* queue_{};
+
+			queue_holder() noexcept : queue_(acquire_queue()) {}
+
+			~queue_holder()
+			{
+				if (queue_)
+					queue_->owned.store(false, std::memory_order_release);
+			}
+
+			queue_holder(queue_holder const&) = delete;
+			queue_holder& operator=(queue_holder const&) = delete;
+		};
+
+		inline queue* local_queue() noexcept
+		{
+			thread_local queue_holder holder_{};
+			return holder_.queue_;
+		}
+
+		/*
+		waits or drops if there is no space, by the policy
+		returns false if dropped
+		*/
+		inline bool reserve(state_type& state_, queue& queue_, std::uint64_t size_) noexcept
+		{
+			std::uint64_t free_ = queue_.free_space();
+			if (free_ >= size_)
+			{
+				// half full, the writer should not wait for the period
+				if (free_ - size_ < queue::capacity / 2 && free_ >= queue::capacity / 2)
+					wake_writer(state_);
+				return true;
+			}
+
+			if (state_.policy.load(std::memory_order_relaxed) == unsigned(policy::drop) ||
+				state_.stop.load(std::memory_order_relaxed))
+			{
+				state_.dropped.fetch_add(1, std::memory_order_relaxed);
+				return false;
+			}
+
+			wake_writer(state_);
+			while ((free_ = queue_.free_space()) < size_)
+			{
+				// the writer is gone at exit, nobody will make the space
+				if (state_.stop.load(std::memory_order_relaxed))
+				{
+					state_.dropped.fetch_add(1, std::memory_order_relaxed);
+					return false;
+				}
+				std::this_thread::yield();
+			}
+			return true;
+		}
+	} // namespace detail
+
+	// the bytes as they are, one message
+	inline void write(const char* text_, std::size_t size_) noexcept
+	{
+		if (size_ > DBJ_ASYNC_LOG_LINE)
+			size_ = DBJ_ASYNC_LOG_LINE;
+		queue* queue_ = detail::local_queue();
+		state_type& state_ = state();
+		if (!queue_)
+		{
+			state_.dropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		if (!detail::reserve(state_, *queue_, sizeof(message_header) + size_))
+			return;
+		queue_->push(kind_text, text_, std::uint32_t(size_));
+	}
+
+	/*
+	formatted on the calling thread, written on the writer thread
+	messages longer than DBJ_ASYNC_LOG_LINE are cut
+	*/
+	template <typename... A>
+	inline void print(const char* format_, A... args_) noexcept
+	{
+		char line_[DBJ_ASYNC_LOG_LINE];
+		const int size_ = std::snprintf(line_, sizeof(line_), format_, args_...);
+		if (size_ <= 0)
+			return;
+		write(line_, std::size_t(size_) < sizeof(line_) ? std::size_t(size_) : sizeof(line_) - 1);
+	}
+
+	/*
+	the format pointer and the arguments go to the queue, the writer formats
+	the format must outlive the writing, the string literal
+	*/
+	template <typename... A>
+	inline void print_deferred(const char* format_, A... args_) noexcept
+	{
+		const std::size_t size_ = deferred::payload_size(args_...);
+		if (size_ > DBJ_ASYNC_LOG_LINE)
+		{
+			print(format_, args_...);
+			return;
+		}
+		queue* queue_ = detail::local_queue();
+		state_type& state_ = state();
+		if (!queue_)
+		{
+			state_.dropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		if (!detail::reserve(state_, *queue_, sizeof(message_header) + size_))
+			return;
+
+		unsigned char payload_[DBJ_ASYNC_LOG_LINE];
+		deferred::pack(payload_, format_, args_...);
+		queue_->push(kind_deferred, payload_, std::uint32_t(size_));
+	}
+
+	// everything printed so far, by any thread, is written when this returns
+	inline void flush() noexcept
+	{
+		detail::drain(state());
+	}
+
+} // namespace dbj::async_log
+
+#ifdef DBJ_ASYNC_LOG_TESTING
+/*
+threads printing, sync fprintf against the async log
+
+	clang++ -std=c++17 -O2 -DDBJ_ASYNC_LOG_TESTING -x c++ dbj_async_log.h 2> /dev/null
+*/
+#include <vector>
+
+namespace dbj::async_log::testing
+{
+	// caller side nanoseconds per message
+	template <typename F>
+	inline double run(unsigned threads_, unsigned per_thread_, F print_)
+	{
+		std::vector<std::thread> workers_;
+		const auto start_ = std::chrono::steady_clock::now();
+		for (unsigned t_ = 0; t_ < threads_; ++t_)
+			workers_.emplace_back([&, t_] {
+				for (unsigned k = 0; k < per_thread_; ++k)
+					print_(t_, k);
+			});
+		for (auto& worker_ : workers_)
+			worker_.join();
+		const double ns_ = double(std::chrono::duration_cast<std::chrono::nanoseconds>(
+									  std::chrono::steady_clock::now() - start_)
+									  .count());
+		return ns_ / (double(threads_) * per_thread_);
+	}
+} // namespace dbj::async_log::testing
+
+int main()
+{
+	using namespace dbj::async_log;
+	constexpr unsigned threads_ = 4, per_thread_ = 50000;
+
+	const double sync_ns_ = testing::run(threads_, per_thread_, [](unsigned t_, unsigned k_) {
+		::fprintf(stderr, "thread %u message %u value %f\n", t_, k_, k_ * 0.5);
+	});
+
+	const double async_ns_ = testing::run(threads_, per_thread_, [](unsigned t_, unsigned k_) {
+		print("thread %u message %u value %f\n", t_, k_, k_ * 0.5);
+	});
+	flush();
+
+	const double deferred_ns_ = testing::run(threads_, per_thread_, [](unsigned t_, unsigned k_) {
+		print_deferred("thread %u message %u value %f name %s\n", t_, k_, k_ * 0.5, "deferred");
+	});
+	flush();
+
+	::printf("\nper message, on the caller  fprintf: %8.1f ns  async: %8.1f ns  deferred: %8.1f ns  dropped: %llu\n",
+			 sync_ns_, async_ns_, deferred_ns_, (unsigned long long)dropped());
+	return 0;
+}
+#endif // DBJ_ASYNC_LOG_TESTING
+
+#endif // DBJ_ASYNC_LOG_INC
@@ -14,6 +14,11 @@ thus no dependancies beside crt and win32
 #include "dbj_common.h"
 #include "win32/win32_console.h" // win_enable_vt_100_and_unicode
 
+// DBJ_PRINT to the background writer, see dbj_async_log.h
+#ifdef DBJ_ASYNC_PRINT
+#include "dbj_async_log.h"
+#endif // DBJ_ASYNC_PRINT
+
 // -----------------------------------------------------------------------------
 #undef  DBJ_PRINT_ALWAYS
 #define DBJ_PRINT_ALWAYS
@@ -31,6 +36,10 @@ namespace dbj {
 	{
 		/// DBJ_ASSERT(msg_ && file_ && line_);
 		/// all the bets are of so no point of using some logging
+#ifdef DBJ_ASYNC_PRINT
+		// but what was logged before should be seen
+		::dbj::async_log::flush();
+#endif // DBJ_ASYNC_PRINT
 		perror("\n\n" DBJ_ERR_PROMPT("\n\ndbj  Terminating error!"));
 		::exit(EXIT_FAILURE);
 	}
@@ -81,7 +90,14 @@ to show us VT100 colours
 			if constexpr (!release_mode_build)
 			{
 #endif // DBJ_PRINT_ALWAYS
+#if defined(DBJ_ASYNC_PRINT) && defined(DBJ_ASYNC_PRINT_DEFERRED)
+				// formatted on the writer thread, format_string must be the literal
+				::dbj::async_log::print_deferred(format_string, args_ ...);
+#elif defined(DBJ_ASYNC_PRINT)
+				::dbj::async_log::print(format_string, args_ ...);
+#else
 				::fprintf(stderr, format_string, args_ ...);
+#endif // DBJ_ASYNC_PRINT
 #ifndef DBJ_PRINT_ALWAYS
 			}
 #endif // DBJ_PRINT_ALWAYS
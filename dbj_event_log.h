@@ -0,0 +1,522 @@
+#ifndef DBJ_EVENT_LOG_INC
+#define DBJ_EVENT_LOG_INC
+
+/*
+(c) 2021 by dbj.org   -- LICENSE DBJ -- https://dbj.org/license_dbj/
+
+dbj binary event log, the flight recorder
+
+DBJ_PRINT formats the text with snprintf when the event happens. in the
+hot path that is the most expensive thing there. the event log stores
+the fixed size record instead: the time stamp, the event kind and up to
+DBJ_EVENT_LOG_ARGS 64 bit arguments. a few stores, no format, no lock.
+the text is made later, offline, from the dump.
+
+	// once, at the namespace scope, the format is for the decoding
+	DBJ_EVENT_KIND(cache_miss, "key: %llu slot: %llu");
+
+	// in the hot path
+	DBJ_EVENT(cache_miss, key_, slot_);
+
+	// when something went wrong, the last events of all the threads
+	dbj::event_log::dump("events.bin");
+
+	// later, maybe in another process of the same build
+	dbj::event_log::decode("events.bin", stdout);
+
+arguments are integers, enums or pointers, each one is kept as 64 bits
+and handed to the format as unsigned long long. thus the format must use
+the 64 bit conversions only: %llu %lld %llx, or none.
+
+each thread has its own ring of DBJ_EVENT_LOG_RING_SIZE records, the
+newest overwrite the oldest. dump() takes the records which are there,
+from any thread, while the others append. rings of the threads which
+are gone are reused by the new threads, their last events are kept.
+
+the dump is in the native byte order, decode it on the same kind of
+machine.
+
+Note: this header does not depend on the rest of dbj, just on the
+dbj_nano_mutex.h and nonstd/dbj_timer.h
+*/
+
+#ifdef __clang__
+#pragma clang system_header
+#endif // __clang__
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+#include "dbj_nano_mutex.h"
+#include "nonstd/dbj_timer.h"
+
+// 64 bit arguments per record
+#ifndef DBJ_EVENT_LOG_ARGS
+#define DBJ_EVENT_LOG_ARGS 3
+#endif
+
+// records per thread, must be the power of two
+#ifndef DBJ_EVENT_LOG_RING_SIZE
+#define DBJ_EVENT_LOG_RING_SIZE (1 << 12)
+#endif
+
+namespace dbj::event_log
+{
+	static_assert((DBJ_EVENT_LOG_RING_SIZE & (DBJ_EVENT_LOG_RING_SIZE - 1)) == 0,
+				  "DBJ_EVENT_LOG_RING_SIZE must be the power of two");
+	static_assert(DBJ_EVENT_LOG_ARGS >= 1 && DBJ_EVENT_LOG_ARGS <= 6,
+				  "DBJ_EVENT_LOG_ARGS must be in [1,6]");
+
+	constexpr inline unsigned args_count = DBJ_EVENT_LOG_ARGS;
+
+	// the plain copy, as in the dump
+	struct record final
+	{
+		std::uint64_t ticks{};
+		std::uint32_t id{};
+		std::uint32_t tid{};
+		std::uint64_t args[args_count]{};
+	};
+
+	/*
+	the event kind, DBJ_EVENT_KIND makes one
+	registers itself on construction, lives as long as the process
+	*/
+	struct kind final
+	{
+		const char* name{};
+		const char* format{};
+		std::uint32_t id{};
+		kind* next{};
+
+		kind(const char* name_arg_, const char* format_arg_) noexcept;
+
+		kind(kind const&) = delete;
+		kind& operator=(kind const&) = delete;
+	};
+
+	struct kinds_type final
+	{
+		std::atomic<kind*> head{nullptr};
+		std::atomic<std::uint32_t> count{0};
+	};
+
+	inline kinds_type& kinds() noexcept
+	{
+		static kinds_type kinds_{};
+		return kinds_;
+	}
+
+	inline kind::kind(const char* name_arg_, const char* format_arg_) noexcept
+		: name(name_arg_), format(format_arg_)
+	{
+		kinds_type& kinds_ = kinds();
+		id = kinds_.count.fetch_add(1, std::memory_order_relaxed);
+		next = kinds_.head.load(std::memory_order_relaxed);
+		while (!kinds_.head.compare_exchange_weak(next, this, std::memory_order_release, std::memory_order_relaxed))
+		{
+		}
+	}
+
+	/*
+	relaxed atomics, since dump() might read the slot which is being
+	overwritten, that copy is detected and thrown away
+	*/
+	struct slot final
+	{
+		std::atomic<std::uint64_t> ticks{0};
+		std::atomic<std::uint32_t> id{0};
+		std::atomic<std::uint32_t> tid{0};
+		std::atomic<std::uint64_t> args[args_count]{};
+	};
+
+	struct ring final
+	{
+		static constexpr std::uint64_t capacity = DBJ_EVENT_LOG_RING_SIZE;
+		static constexpr std::uint64_t mask = capacity - 1;
+
+		// written by the owner only
+		alignas(DBJ_NANO_CACHE_LINE) std::atomic<std::uint64_t> head{0};
+		std::uint32_t tid{};
+
+		std::atomic<bool> owned{false};
+		ring* next{};
+
+		slot slots[capacity]{};
+
+		void append(std::uint32_t id_, std::uint64_t const (&args_)[args_count]) noexcept
+		{
+			const std::uint64_t idx_ = head.load(std::memory_order_relaxed);
+			slot& slot_ = slots[idx_ & mask];
+			// as the seqlock writer, the slot stores can not move above this point
+			// the reader who sees one of them sees the head up to idx_ after its fence
+			std::atomic_thread_fence(std::memory_order_release);
+			slot_.ticks.store(stopwatch::tsc::now_ticks(), std::memory_order_relaxed);
+			slot_.id.store(id_, std::memory_order_relaxed);
+			slot_.tid.store(tid, std::memory_order_relaxed);
+			for (unsigned k = 0; k < args_count; ++k)
+				slot_.args[k].store(args_[k], std::memory_order_relaxed);
+			head.store(idx_ + 1, std::memory_order_release);
+		}
+
+		// appends the records which are there, oldest first
+		void copy_to(std::vector<record>& out_) const
+		{
+			const std::uint64_t head_ = head.load(std::memory_order_acquire);
+			const std::uint64_t from_ = head_ > capacity ? head_ - capacity : 0;
+			const std::size_t start_ = out_.size();
+			out_.resize(start_ + std::size_t(head_ - from_));
+
+			for (std::uint64_t k = from_; k < head_; ++k)
+			{
+				slot const& slot_ = slots[k & mask];
+				record& copy_ = out_[start_ + std::size_t(k - from_)];
+				copy_.ticks = slot_.ticks.load(std::memory_order_relaxed);
+				copy_.id = slot_.id.load(std::memory_order_relaxed);
+				copy_.tid = slot_.tid.load(std::memory_order_relaxed);
+				for (unsigned a = 0; a < args_count; ++a)
+					copy_.args[a] = slot_.args[a].load(std::memory_order_relaxed);
+			}
+
+			// the copies can not move bellow the head load
+			// the ones the owner might have started overwriting are not valid
+			std::atomic_thread_fence(std::memory_order_acquire);
+			const std::uint64_t head_now_ = head.load(std::memory_order_relaxed);
+			const std::uint64_t valid_from_ = head_now_ > capacity ? head_now_ - capacity + 1 : 0;
+			if (valid_from_ > from_)
+			{
+				const std::size_t invalid_ = std::size_t(std::min(valid_from_, head_) - from_);
+				out_.erase(out_.begin() + std::ptrdiff_t(start_), out_.begin() + std::ptrdiff_t(start_ + invalid_));
+			}
+		}
+	};
+
+	struct state_type final
+	{
+		std::atomic<ring*> rings{nullptr};
+		// one dump at the time
+		nano::mutex lock;
+	};
+
+	inline state_type& state() noexcept
+	{
+		static state_type state_{};
+		return state_;
+	}
+
+	namespace detail
+	{
+		// takes the free ring or makes the new one, nullptr if out of memory
+		inline ring* acquire_ring() noexcept
+		{
+			state_type& state_ = state();
+			for (ring* walker_ = state_.rings.load(std::memory_order_acquire); walker_; walker_ = walker_->next)
+			{
+				bool expected_ = false;
+				if (walker_->owned.compare_exchange_strong(expected_, true, std::memory_order_acquire))
+					return walker_;
+			}
+			ring* new_ = new (std::nothrow) ring{};
+			if (!new_)
+				return nullptr;
+			new_->owned.store(true, std::memory_order_relaxed);
+			new_->next = state_.rings.load(std::memory_order_relaxed);
+			while (!state_.rings.compare_exchange_weak(new_->next, new_, std::memory_order_release, std::memory_order_relaxed))
+			{
+			}
+			return new_;
+		}
+
+		// gives the ring back when the thread is gone
+		struct ring_holder final
+		{
+			ring* ring_{};
+
+			ring_holder() noexcept : ring_(acquire_ring())
+			{
+				if (ring_)
+					ring_->tid = std::uint32_t(nano::this_thread_index());
+			}
+
+			~ring_holder()
+			{
+				if (ring_)
+					ring_->owned.store(false, std::memory_order_release);
+			}
+
+			ring_holder(ring_holder const&) = delete;
+			ring_holder& operator=(ring_holder const&) = delete;
+		};
+
+		inline ring* local_ring() noexcept
+		{
+			thread_local ring_holder holder_{};
+			return holder_.ring_;
+		}
+
+		template <typename T>
+		inline std::uint64_t to_arg(T value_) noexcept
+		{
+			static_assert(std::is_integral_v<T> || std::is_enum_v<T> || std::is_pointer_v<T>,
+						  "DBJ_EVENT -- arguments must be integers, enums or pointers");
+			if constexpr (std::is_pointer_v<T>)
+				return std::uint64_t(reinterpret_cast<std::uintptr_t>(value_));
+			else
+				return std::uint64_t(value_);
+		}
+
+		// the dump file
+		constexpr inline char magic[8]{'D', 'B', 'J', 'E', 'V', 'L', 'O', 'G'};
+		constexpr inline std::uint32_t version = 1;
+
+		struct header final
+		{
+			char magic[8]{};
+			std::uint32_t version{};
+			std::uint32_t args_count{};
+			double ns_per_tick{};
+			std::uint32_t kinds_count{};
+			std::uint32_t reserved{};
+			std::uint64_t records_count{};
+		};
+
+		// kind in the dump: id, name length, format length, then the strings
+		struct kind_header final
+		{
+			std::uint32_t id{};
+			std::uint16_t name_length{};
+			std::uint16_t format_length{};
+		};
+	} // namespace detail
+
+	template <typename... A>
+	inline void append(kind const& kind_, A... args_) noexcept
+	{
+		static_assert(sizeof...(A) <= args_count, "DBJ_EVENT -- too many arguments, see DBJ_EVENT_LOG_ARGS");
+		const std::uint64_t values_[args_count]{detail::to_arg(args_)...};
+		if (ring* ring_ = detail::local_ring())
+			ring_->append(kind_.id, values_);
+	}
+
+	// the records of all the threads, oldest first
+	inline std::vector<record> snapshot()
+	{
+		std::vector<record> records_;
+		for (ring* walker_ = state().rings.load(std::memory_order_acquire); walker_; walker_ = walker_->next)
+			walker_->copy_to(records_);
+		std::stable_sort(records_.begin(), records_.end(),
+						 [](record const& l_, record const& r_) { return l_.ticks < r_.ticks; });
+		return records_;
+	}
+
+	// returns false if the file could not be written
+	inline bool dump(const char* path_) noexcept
+	{
+		state_type& state_ = state();
+		state_.lock.lock();
+
+		FILE* file_ = std::fopen(path_, "wb");
+		if (!file_)
+		{
+			state_.lock.unlock();
+			std::perror(" (" __FILE__ ") dbj::event_log::dump()");
+			return false;
+		}
+
+		const std::vector<record> records_ = snapshot();
+
+		detail::header header_{};
+		std::memcpy(header_.magic, detail::magic, sizeof(header_.magic));
+		header_.version = detail::version;
+		header_.args_count = args_count;
+		header_.ns_per_tick = stopwatch::tsc::calibrated().ns_per_tick;
+		header_.kinds_count = kinds().count.load(std::memory_order_acquire);
+		header_.records_count = records_.size();
+
+		bool ok_ = 1 == std::fwrite(&header_, sizeof(header_), 1, file_);
+
+		std::uint32_t written_{};
+		for (kind* walker_ = kinds().head.load(std::memory_order_acquire); walker_ && ok_; walker_ = walker_->next)
+		{
+			detail::kind_header kind_{};
+			kind_.id = walker_->id;
+			kind_.name_length = std::uint16_t(std::strlen(walker_->name));
+			kind_.format_length = std::uint16_t(std::strlen(walker_->format));
+			ok_ = 1 == std::fwrite(&kind_, sizeof(kind_), 1, file_);
+			ok_ = ok_ && kind_.name_length == std::fwrite(walker_->name, 1, kind_.name_length, file_);
+			ok_ = ok_ && kind_.format_length == std::fwrite(walker_->format, 1, kind_.format_length, file_);
+			++written_;
+		}
+		// registered while we were walking, the count in the header is wrong
+		ok_ = ok_ && written_ == header_.kinds_count;
+
+		ok_ = ok_ && records_.size() == std::fwrite(records_.data(), sizeof(record), records_.size(), file_);
+		ok_ = (0 == std::fclose(file_)) && ok_;
+
+		state_.lock.unlock();
+		if (!ok_)
+			std::perror(" (" __FILE__ ") dbj::event_log::dump()");
+		return ok_;
+	}
+
+	/*
+	the dump to the text, one line per record
+
+		microseconds from the first record, thread index, kind name, arguments
+
+	returns false if the file is not the dump of this build
+	*/
+	inline bool decode(const char* path_, FILE* out_) noexcept
+	{
+		FILE* file_ = std::fopen(path_, "rb");
+		if (!file_)
+		{
+			std::perror(" (" __FILE__ ") dbj::event_log::decode()");
+			return false;
+		}
+
+		struct decoded_kind
+		{
+			std::uint32_t id;
+			char name[64];
+			char format[256];
+		};
+
+		bool ok_ = true;
+		detail::header header_{};
+		std::vector<decoded_kind> kinds_;
+		std::vector<record> records_;
+
+		ok_ = 1 == std::fread(&header_, sizeof(header_), 1, file_) &&
+			  0 == std::memcmp(header_.magic, detail::magic, sizeof(header_.magic)) &&
+			  header_.version == detail::version && header_.args_count == args_count;
+
+		for (std::uint32_t k = 0; ok_ && k < header_.kinds_count; ++k)
+		{
+			detail::kind_header kind_header_{};
+			decoded_kind kind_{};
+			ok_ = 1 == std::fread(&kind_header_, sizeof(kind_header_), 1, file_);
+			kind_.id = kind_header_.id;
+			// DBJ NOTE: longer than the buffers is cut, not the error
+			for (std::uint32_t c = 0; ok_ && c < kind_header_.name_length; ++c)
+			{
+				const int char_ = std::fgetc(file_);
+				ok_ = char_ != EOF;
+				if (c + 1 < sizeof(kind_.name))
+					kind_.name[c] = char(char_);
+			}
+			for (std::uint32_t c = 0; ok_ && c < kind_header_.format_length; ++c)
+			{
+				const int char_ = std::fgetc(file_);
+				ok_ = char_ != EOF;
+				if (c + 1 < sizeof(kind_.format))
+					kind_.format[c] = char(char_);
+			}
+			kinds_.push_back(kind_);
+		}
+
+		if (ok_)
+		{
+			records_.resize(std::size_t(header_.records_count));
+			ok_ = records_.size() == std::fread(records_.data(), sizeof(record), records_.size(), file_);
+		}
+		std::fclose(file_);
+
+		if (!ok_)
+		{
+			::fprintf(stderr, "\n (" __FILE__ ") dbj::event_log::decode() -- %s is not the event log dump of this build\n", path_);
+			return false;
+		}
+
+		const std::uint64_t origin_ = records_.empty() ? 0 : records_.front().ticks;
+		for (record const& record_ : records_)
+		{
+			const decoded_kind* kind_ = nullptr;
+			for (decoded_kind const& candidate_ : kinds_)
+				if (candidate_.id == record_.id)
+				{
+					kind_ = &candidate_;
+					break;
+				}
+
+			::fprintf(out_, "%14.3f  %4u  %-24s ",
+					  double(record_.ticks - origin_) * header_.ns_per_tick / 1000.0,
+					  record_.tid, kind_ ? kind_->name : "?");
+
+			// unused arguments are ignored by the printf
+			unsigned long long a_[6]{};
+			for (unsigned k = 0; k < args_count; ++k)
+				a_[k] = record_.args[k];
+			if (kind_)
+				::fprintf(out_, kind_->format, a_[0], a_[1], a_[2], a_[3], a_[4], a_[5]);
+			else
+				::fprintf(out_, "id: %u", record_.id);
+			::fputc('\n', out_);
+		}
+		return true;
+	}
+
+} // namespace dbj::event_log
+
+// at the namespace scope, once per kind
+#define DBJ_EVENT_KIND(NAME_, FORMAT_) \
+	inline ::dbj::event_log::kind dbj_event_kind_##NAME_{#NAME_, FORMAT_}
+
+#define DBJ_EVENT(NAME_, ...) ::dbj::event_log::append(dbj_event_kind_##NAME_, ##__VA_ARGS__)
+
+#ifdef DBJ_EVENT_LOG_TESTING
+/*
+events from a few threads, dumped and decoded, and the cost of one event
+
+	clang++ -std=c++17 -O2 -DDBJ_EVENT_LOG_TESTING -x c++ dbj_event_log.h
+*/
+#include <thread>
+
+DBJ_EVENT_KIND(job_start, "job: %llu");
+DBJ_EVENT_KIND(job_done, "job: %llu result: %llx");
+DBJ_EVENT_KIND(tick, "");
+
+int main()
+{
+	// the main thread takes its ring before the others
+	DBJ_EVENT(tick);
+
+	std::vector<std::thread> threads_;
+	for (unsigned t_ = 0; t_ < 3; ++t_)
+		threads_.emplace_back([t_] {
+			for (std::uint64_t job_ = 0; job_ < 4; ++job_)
+			{
+				DBJ_EVENT(job_start, t_ * 100 + job_);
+				DBJ_EVENT(job_done, t_ * 100 + job_, (t_ * 100 + job_) * 0x9E3779B9ull);
+			}
+		});
+	for (auto& thread_ : threads_)
+		thread_.join();
+
+	// overwrites most of the main thread ring
+	const std::uint64_t start_ = dbj::stopwatch::tsc::steady_ns();
+	constexpr unsigned count_ = 1000000;
+	for (unsigned k = 0; k < count_; ++k)
+		DBJ_EVENT(tick);
+	const double cost_ = double(dbj::stopwatch::tsc::steady_ns() - start_) / count_;
+
+	if (!dbj::event_log::dump("events.bin"))
+		return 1;
+	FILE* text_ = std::fopen("events.txt", "w");
+	if (!text_ || !dbj::event_log::decode("events.bin", text_))
+		return 1;
+	std::fclose(text_);
+
+	::printf("\n%.3f ns per event, decoded to events.txt\n", cost_);
+	return 0;
+}
+#endif // DBJ_EVENT_LOG_TESTING
+
+#endif // DBJ_EVENT_LOG_INC
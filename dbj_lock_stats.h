@@ -0,0 +1,328 @@
+#ifndef DBJ_LOCK_STATS_INC
+#define DBJ_LOCK_STATS_INC
+
+/*
+(c) 2021 by dbj.org   -- LICENSE DBJ -- https://dbj.org/license_dbj/
+
+dbj nano synchro lock contention statistics
+
+opt in, define DBJ_LOCK_STATS before including dbj_nano_synchro.h
+Without it everything in here is an empty inline forward to lock()/unlock()
+and compiles to nothing.
+
+Kept per lock and per call site (the autolock macros give __FILE__ and
+__LINE__) :
+
+	acquisitions
+	contended acquisitions -- try_lock() failed, had to wait
+	total and max wait time
+	total and max hold time
+
+	dbj::lock_stats::report();         // table to stderr
+	dbj::lock_stats::for_each( [](dbj::lock_stats::record const & r_) { ... } );
+	dbj::lock_stats::reset();
+
+Counters are relaxed atomics, the numbers are statistics not the
+synchronization. Times are steady_clock nanoseconds.
+
+Hold time is measured for the exclusive locks. For the shared locks only
+by the scoped types, synchro_enter_shared() has nowhere to keep the time.
+*/
+
+#ifdef __clang__
+#pragma clang system_header
+#endif // __clang__
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+
+#ifdef DBJ_LOCK_STATS
+#include <chrono>
+#endif // DBJ_LOCK_STATS
+
+namespace dbj::lock_stats
+{
+#ifdef DBJ_LOCK_STATS
+
+	inline std::uint64_t now_ns() noexcept
+	{
+		return static_cast<std::uint64_t>(
+			std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::steady_clock::now().time_since_epoch())
+				.count());
+	}
+
+	inline void atomic_max(std::atomic<std::uint64_t>& target_, std::uint64_t value_) noexcept
+	{
+		std::uint64_t current_ = target_.load(std::memory_order_relaxed);
+		while (current_ < value_ &&
+			   !target_.compare_exchange_weak(current_, value_, std::memory_order_relaxed))
+		{
+		}
+	}
+
+	/*
+	one per lock or per call site
+	registers itself on construction, lives as long as the process
+	*/
+	struct record final
+	{
+		// lock name, or the call site file
+		const char* name{};
+		// call site line, -1 for locks
+		int line{-1};
+		// stripe index, -1 if not a stripe
+		int index{-1};
+
+		std::atomic<std::uint64_t> acquisitions{0};
+		std::atomic<std::uint64_t> contended{0};
+		std::atomic<std::uint64_t> wait_ns{0};
+		std::atomic<std::uint64_t> max_wait_ns{0};
+		std::atomic<std::uint64_t> hold_ns{0};
+		std::atomic<std::uint64_t> max_hold_ns{0};
+
+		// owner only, written and read under the lock this is the record of
+		std::uint64_t held_since{};
+		record* holder_site{};
+
+		record* next{};
+
+		explicit record(const char* name_arg_, int line_arg_ = -1) noexcept;
+
+		record(record const&) = delete;
+		record& operator=(record const&) = delete;
+
+		bool is_site() const noexcept { return line >= 0; }
+
+		void on_acquire(std::uint64_t wait_, bool contended_) noexcept
+		{
+			acquisitions.fetch_add(1, std::memory_order_relaxed);
+			if (contended_)
+			{
+				contended.fetch_add(1, std::memory_order_relaxed);
+				wait_ns.fetch_add(wait_, std::memory_order_relaxed);
+				atomic_max(max_wait_ns, wait_);
+			}
+		}
+
+		void on_release(std::uint64_t hold_) noexcept
+		{
+			hold_ns.fetch_add(hold_, std::memory_order_relaxed);
+			atomic_max(max_hold_ns, hold_);
+		}
+
+		void clear() noexcept
+		{
+			acquisitions = 0;
+			contended = 0;
+			wait_ns = 0;
+			max_wait_ns = 0;
+			hold_ns = 0;
+			max_hold_ns = 0;
+		}
+	};
+
+	inline std::atomic<record*>& registry() noexcept
+	{
+		static std::atomic<record*> head_{nullptr};
+		return head_;
+	}
+
+	inline record::record(const char* name_arg_, int line_arg_) noexcept
+		: name(name_arg_), line(line_arg_)
+	{
+		std::atomic<record*>& head_ = registry();
+		next = head_.load(std::memory_order_relaxed);
+		while (!head_.compare_exchange_weak(next, this, std::memory_order_release, std::memory_order_relaxed))
+		{
+		}
+	}
+
+	// F is void ( record const & )
+	template <typename F>
+	inline void for_each(F&& fun_)
+	{
+		for (record* walker_ = registry().load(std::memory_order_acquire); walker_; walker_ = walker_->next)
+			fun_(static_cast<record const&>(*walker_));
+	}
+
+	inline void reset() noexcept
+	{
+		for (record* walker_ = registry().load(std::memory_order_acquire); walker_; walker_ = walker_->next)
+			walker_->clear();
+	}
+
+	// records never used are not shown
+	inline void report(FILE* out_ = stderr) noexcept
+	{
+		::fprintf(out_, "\n%-48s %12s %12s %14s %12s %14s %12s",
+				  "lock or call site", "acquired", "contended", "wait us", "max wait us", "hold us", "max hold us");
+
+		for_each([out_](record const& rec_) {
+			const std::uint64_t acquisitions_ = rec_.acquisitions.load(std::memory_order_relaxed);
+			if (acquisitions_ == 0)
+				return;
+
+			char label_[48 + 1]{};
+			if (rec_.is_site())
+				::snprintf(label_, sizeof(label_), "%s(%d)", rec_.name, rec_.line);
+			else if (rec_.index >= 0)
+				::snprintf(label_, sizeof(label_), "%s #%d", rec_.name, rec_.index);
+			else
+				::snprintf(label_, sizeof(label_), "%s", rec_.name);
+
+			::fprintf(out_, "\n%-48s %12llu %12llu %14.3f %12.3f %14.3f %12.3f",
+					  label_,
+					  (unsigned long long)acquisitions_,
+					  (unsigned long long)rec_.contended.load(std::memory_order_relaxed),
+					  rec_.wait_ns.load(std::memory_order_relaxed) / 1000.0,
+					  rec_.max_wait_ns.load(std::memory_order_relaxed) / 1000.0,
+					  rec_.hold_ns.load(std::memory_order_relaxed) / 1000.0,
+					  rec_.max_hold_ns.load(std::memory_order_relaxed) / 1000.0);
+		});
+		::fprintf(out_, "\n");
+	}
+
+	/*
+	for the callers which acquire the lock themselves, try or timed
+	wait_ is from now_ns(), returns the time of acquisition
+	*/
+	inline std::uint64_t on_acquired(record* lock_rec_, record* site_, std::uint64_t wait_, bool contended_) noexcept
+	{
+		lock_rec_->on_acquire(wait_, contended_);
+		if (site_)
+			site_->on_acquire(wait_, contended_);
+		return now_ns();
+	}
+
+	// try first, so we know if it was contended
+	// returns the time of acquisition
+	template <typename L>
+	inline std::uint64_t lock_exclusive(L& lock_, record* lock_rec_, record* site_) noexcept
+	{
+		std::uint64_t wait_{};
+		const bool contended_ = !lock_.try_lock();
+		if (contended_)
+		{
+			const std::uint64_t start_ = now_ns();
+			lock_.lock();
+			wait_ = now_ns() - start_;
+		}
+		lock_rec_->on_acquire(wait_, contended_);
+		if (site_)
+			site_->on_acquire(wait_, contended_);
+		return now_ns();
+	}
+
+	template <typename L>
+	inline void unlock_exclusive(L& lock_, record* lock_rec_, record* site_, std::uint64_t since_) noexcept
+	{
+		const std::uint64_t hold_ = now_ns() - since_;
+		lock_rec_->on_release(hold_);
+		if (site_)
+			site_->on_release(hold_);
+		lock_.unlock();
+	}
+
+	/*
+	for the locks with their own record, as the synchro_enter() / synchro_leave()
+	pair, where the caller has nowhere to keep the acquisition time
+	the owner keeps it in the lock record
+	*/
+	template <typename L>
+	inline void lock_owned(L& lock_, record* lock_rec_, record* site_) noexcept
+	{
+		const std::uint64_t since_ = lock_exclusive(lock_, lock_rec_, site_);
+		// we are the owner now
+		lock_rec_->holder_site = site_;
+		lock_rec_->held_since = since_;
+	}
+
+	template <typename L>
+	inline void unlock_owned(L& lock_, record* lock_rec_) noexcept
+	{
+		unlock_exclusive(lock_, lock_rec_, lock_rec_->holder_site, lock_rec_->held_since);
+	}
+
+	// returns the time of acquisition
+	template <typename L>
+	inline std::uint64_t lock_shared(L& lock_, record* lock_rec_, record* site_) noexcept
+	{
+		std::uint64_t wait_{};
+		const bool contended_ = !lock_.try_lock_shared();
+		if (contended_)
+		{
+			const std::uint64_t start_ = now_ns();
+			lock_.lock_shared();
+			wait_ = now_ns() - start_;
+		}
+		lock_rec_->on_acquire(wait_, contended_);
+		if (site_)
+			site_->on_acquire(wait_, contended_);
+		return now_ns();
+	}
+
+	// since_ == 0 means hold time is unknown
+	template <typename L>
+	inline void unlock_shared(L& lock_, record* lock_rec_, record* site_, std::uint64_t since_) noexcept
+	{
+		if (since_ != 0)
+		{
+			const std::uint64_t hold_ = now_ns() - since_;
+			lock_rec_->on_release(hold_);
+			if (site_)
+				site_->on_release(hold_);
+		}
+		lock_.unlock_shared();
+	}
+
+#define DBJ_LOCK_STATS_MEMBER(NAME_) ::dbj::lock_stats::record stats_{NAME_};
+#define DBJ_LOCK_STATS_OF(OBJ_) (&(OBJ_).stats_)
+
+#else // ! DBJ_LOCK_STATS
+
+	// nothing to see here
+	struct record;
+
+	inline std::uint64_t now_ns() noexcept { return 0; }
+	inline std::uint64_t on_acquired(record*, record*, std::uint64_t, bool) noexcept { return 0; }
+
+	template <typename F>
+	inline void for_each(F&&) noexcept {}
+	inline void reset() noexcept {}
+	inline void report(FILE* = stderr) noexcept {}
+
+	template <typename L>
+	inline std::uint64_t lock_exclusive(L& lock_, record*, record*) noexcept
+	{
+		lock_.lock();
+		return 0;
+	}
+
+	template <typename L>
+	inline void unlock_exclusive(L& lock_, record*, record*, std::uint64_t) noexcept { lock_.unlock(); }
+
+	template <typename L>
+	inline void lock_owned(L& lock_, record*, record*) noexcept { lock_.lock(); }
+
+	template <typename L>
+	inline void unlock_owned(L& lock_, record*) noexcept { lock_.unlock(); }
+
+	template <typename L>
+	inline std::uint64_t lock_shared(L& lock_, record*, record*) noexcept
+	{
+		lock_.lock_shared();
+		return 0;
+	}
+
+	template <typename L>
+	inline void unlock_shared(L& lock_, record*, record*, std::uint64_t) noexcept { lock_.unlock_shared(); }
+
+#define DBJ_LOCK_STATS_MEMBER(NAME_)
+#define DBJ_LOCK_STATS_OF(OBJ_) ((::dbj::lock_stats::record*)nullptr)
+
+#endif // ! DBJ_LOCK_STATS
+} // namespace dbj::lock_stats
+
+#endif // DBJ_LOCK_STATS_INC
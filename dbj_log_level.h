@@ -0,0 +1,283 @@
+#ifndef DBJ_LOG_LEVEL_INC
+#define DBJ_LOG_LEVEL_INC
+
+/*
+(c) 2021 by dbj.org   -- LICENSE DBJ -- https://dbj.org/license_dbj/
+
+dbj leveled logging, on top of DBJ_PRINT
+
+	// once, in one header, the module name is the identifier
+	DBJ_LOG_MODULE(net);
+
+	DBJ_LOG_TRACE(net, "packet %d bytes\n", size_);
+	DBJ_LOG_WARN(net, "retrying %s\n", host_);
+
+	// at runtime
+	dbj::log::set_level("net", dbj::log::level::debug);
+
+compile time: the levels bellow DBJ_LOG_LEVEL are the empty macros, the
+arguments are not evaluated, nothing is left in the binary.
+
+	#define DBJ_LOG_LEVEL DBJ_LOG_LEVEL_WARN   // before including
+
+the default is trace in the debug builds, info in the release builds.
+
+runtime: each module has its own level, the check is one relaxed load
+and one branch. the starting level is DBJ_LOG_DEFAULT_LEVEL, or what the
+DBJ_LOG environment variable says
+
+	DBJ_LOG=net=trace,db=error,*=warn
+
+the output is DBJ_PRINT, thus the async log if DBJ_ASYNC_PRINT is
+defined. each line is prefixed with the level and the module.
+*/
+
+#ifdef __clang__
+#pragma clang system_header
+#endif // __clang__
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+
+#include "dbj_debug.h"
+
+#define DBJ_LOG_LEVEL_TRACE 0
+#define DBJ_LOG_LEVEL_DEBUG 1
+#define DBJ_LOG_LEVEL_INFO 2
+#define DBJ_LOG_LEVEL_WARN 3
+#define DBJ_LOG_LEVEL_ERROR 4
+#define DBJ_LOG_LEVEL_OFF 5
+
+// compile time threshold
+#ifndef DBJ_LOG_LEVEL
+#ifdef _DEBUG
+#define DBJ_LOG_LEVEL DBJ_LOG_LEVEL_TRACE
+#else
+#define DBJ_LOG_LEVEL DBJ_LOG_LEVEL_INFO
+#endif
+#endif // DBJ_LOG_LEVEL
+
+// runtime level of the modules, before set_level() or DBJ_LOG
+#ifndef DBJ_LOG_DEFAULT_LEVEL
+#define DBJ_LOG_DEFAULT_LEVEL DBJ_LOG_LEVEL_INFO
+#endif
+
+namespace dbj::log
+{
+	enum class level : unsigned char
+	{
+		trace = DBJ_LOG_LEVEL_TRACE,
+		debug = DBJ_LOG_LEVEL_DEBUG,
+		info = DBJ_LOG_LEVEL_INFO,
+		warn = DBJ_LOG_LEVEL_WARN,
+		error = DBJ_LOG_LEVEL_ERROR,
+		off = DBJ_LOG_LEVEL_OFF
+	};
+
+	inline constexpr const char* level_names[]{"trace", "debug", "info", "warn", "error", "off"};
+
+	// level::off + 1 if not found
+	inline unsigned level_from_name(const char* name_, std::size_t size_) noexcept
+	{
+		for (unsigned k = 0; k <= unsigned(level::off); ++k)
+			if (std::strlen(level_names[k]) == size_ && 0 == std::strncmp(level_names[k], name_, size_))
+				return k;
+		return unsigned(level::off) + 1;
+	}
+
+	/*
+	the level from the "name=level,*=level" spec, DBJ_LOG_DEFAULT_LEVEL
+	if the module is not there. the exact name wins over the *
+	*/
+	inline unsigned level_from_spec(const char* spec_, const char* module_) noexcept
+	{
+		unsigned retval_ = DBJ_LOG_DEFAULT_LEVEL;
+		if (!spec_)
+			return retval_;
+		const std::size_t module_size_ = std::strlen(module_);
+		bool exact_ = false;
+		while (*spec_)
+		{
+			const char* end_ = spec_;
+			while (*end_ && *end_ != ',')
+				++end_;
+			const char* equal_ = spec_;
+			while (equal_ < end_ && *equal_ != '=')
+				++equal_;
+			if (equal_ < end_)
+			{
+				const std::size_t name_size_ = std::size_t(equal_ - spec_);
+				const unsigned found_ = level_from_name(equal_ + 1, std::size_t(end_ - equal_ - 1));
+				if (found_ <= unsigned(level::off))
+				{
+					if (name_size_ == module_size_ && 0 == std::strncmp(spec_, module_, name_size_))
+					{
+						retval_ = found_;
+						exact_ = true;
+					}
+					else if (!exact_ && name_size_ == 1 && *spec_ == '*')
+						retval_ = found_;
+				}
+			}
+			spec_ = *end_ ? end_ + 1 : end_;
+		}
+		return retval_;
+	}
+
+	/*
+	one per DBJ_LOG_MODULE, registered on the construction
+	never destroyed before the end of the program
+	*/
+	struct module final
+	{
+		const char* name{};
+		std::atomic<unsigned char> threshold{DBJ_LOG_DEFAULT_LEVEL};
+		module* next{};
+
+		inline static std::atomic<module*> modules{nullptr};
+
+		explicit module(const char* name_) noexcept : name(name_)
+		{
+			threshold.store((unsigned char)level_from_spec(std::getenv("DBJ_LOG"), name_), std::memory_order_relaxed);
+			next = modules.load(std::memory_order_relaxed);
+			while (!modules.compare_exchange_weak(next, this, std::memory_order_release, std::memory_order_relaxed))
+			{
+			}
+		}
+
+		module(module const&) = delete;
+		module& operator=(module const&) = delete;
+
+		// the hot path
+		bool enabled(level level_) const noexcept
+		{
+			return (unsigned char)level_ >= threshold.load(std::memory_order_relaxed);
+		}
+	};
+
+	// false if there is no such module
+	inline bool set_level(const char* name_, level level_) noexcept
+	{
+		for (module* walker_ = module::modules.load(std::memory_order_acquire); walker_; walker_ = walker_->next)
+			if (0 == std::strcmp(walker_->name, name_))
+			{
+				walker_->threshold.store((unsigned char)level_, std::memory_order_relaxed);
+				return true;
+			}
+		return false;
+	}
+
+	// all the modules
+	inline void set_level(level level_) noexcept
+	{
+		for (module* walker_ = module::modules.load(std::memory_order_acquire); walker_; walker_ = walker_->next)
+			walker_->threshold.store((unsigned char)level_, std::memory_order_relaxed);
+	}
+
+	// level::off if there is no such module
+	inline level get_level(const char* name_) noexcept
+	{
+		for (module* walker_ = module::modules.load(std::memory_order_acquire); walker_; walker_ = walker_->next)
+			if (0 == std::strcmp(walker_->name, name_))
+				return level(walker_->threshold.load(std::memory_order_relaxed));
+		return level::off;
+	}
+} // namespace dbj::log
+
+// the module, an inline variable, thus in the header
+#define DBJ_LOG_MODULE(NAME_) inline ::dbj::log::module dbj_log_module_##NAME_{#NAME_}
+
+// DBJ NOTE: the prefix is glued to the format, thus the format must be the literal
+#define DBJ_LOG_AT_(LEVEL_, MODULE_, FORMAT_, ...)                                         \
+	do                                                                                    \
+	{                                                                                     \
+		if (dbj_log_module_##MODULE_.enabled(::dbj::log::level::LEVEL_))                  \
+			DBJ_PRINT("[" #LEVEL_ "] " #MODULE_ ": " FORMAT_, ##__VA_ARGS__);             \
+	} while (false)
+
+#define DBJ_LOG_ELIDED_ \
+	do                  \
+	{                   \
+	} while (false)
+
+#if DBJ_LOG_LEVEL <= DBJ_LOG_LEVEL_TRACE
+#define DBJ_LOG_TRACE(MODULE_, ...) DBJ_LOG_AT_(trace, MODULE_, __VA_ARGS__)
+#else
+#define DBJ_LOG_TRACE(MODULE_, ...) DBJ_LOG_ELIDED_
+#endif
+
+#if DBJ_LOG_LEVEL <= DBJ_LOG_LEVEL_DEBUG
+#define DBJ_LOG_DEBUG(MODULE_, ...) DBJ_LOG_AT_(debug, MODULE_, __VA_ARGS__)
+#else
+#define DBJ_LOG_DEBUG(MODULE_, ...) DBJ_LOG_ELIDED_
+#endif
+
+#if DBJ_LOG_LEVEL <= DBJ_LOG_LEVEL_INFO
+#define DBJ_LOG_INFO(MODULE_, ...) DBJ_LOG_AT_(info, MODULE_, __VA_ARGS__)
+#else
+#define DBJ_LOG_INFO(MODULE_, ...) DBJ_LOG_ELIDED_
+#endif
+
+#if DBJ_LOG_LEVEL <= DBJ_LOG_LEVEL_WARN
+#define DBJ_LOG_WARN(MODULE_, ...) DBJ_LOG_AT_(warn, MODULE_, __VA_ARGS__)
+#else
+#define DBJ_LOG_WARN(MODULE_, ...) DBJ_LOG_ELIDED_
+#endif
+
+#if DBJ_LOG_LEVEL <= DBJ_LOG_LEVEL_ERROR
+#define DBJ_LOG_ERROR(MODULE_, ...) DBJ_LOG_AT_(error, MODULE_, __VA_ARGS__)
+#else
+#define DBJ_LOG_ERROR(MODULE_, ...) DBJ_LOG_ELIDED_
+#endif
+
+// DBJ_CHK at the level, x is not evaluated when the level is off
+#define DBJ_LOG_CHK(LEVEL_, MODULE_, x)                                                          \
+	do                                                                                          \
+	{                                                                                           \
+		if constexpr (unsigned(::dbj::log::level::LEVEL_) >= DBJ_LOG_LEVEL)                     \
+		{                                                                                       \
+			if (dbj_log_module_##MODULE_.enabled(::dbj::log::level::LEVEL_) && false == (x))    \
+				DBJ_PRINT("[" #LEVEL_ "] " #MODULE_ ": Evaluated to false! " #x "\n");          \
+		}                                                                                       \
+	} while (false)
+
+#ifdef DBJ_LOG_LEVEL_TESTING
+/*
+	clang++ -std=c++17 -D_DEBUG -DDBJ_LOG_LEVEL=DBJ_LOG_LEVEL_DEBUG -DDBJ_LOG_LEVEL_TESTING -x c++ dbj_log_level.h
+*/
+DBJ_LOG_MODULE(net);
+DBJ_LOG_MODULE(db);
+
+inline int dbj_log_level_testing_calls_ = 0;
+inline int dbj_log_level_testing_call() { return ++dbj_log_level_testing_calls_; }
+
+int main()
+{
+	// below the compile time threshold, the argument is not evaluated
+	DBJ_LOG_TRACE(net, "never %d\n", dbj_log_level_testing_call());
+	DBJ_VERIFY((dbj_log_level_testing_calls_ == 0));
+
+	// below the runtime threshold, not printed and not evaluated
+	dbj::log::set_level("net", dbj::log::level::warn);
+	DBJ_LOG_INFO(net, "not printed %d\n", dbj_log_level_testing_call());
+	DBJ_VERIFY((dbj_log_level_testing_calls_ == 0));
+
+	DBJ_LOG_WARN(net, "printed %d\n", dbj_log_level_testing_call());
+	DBJ_VERIFY((dbj_log_level_testing_calls_ == 1));
+
+	DBJ_LOG_DEBUG(db, "debug, if DBJ_LOG says so\n");
+	DBJ_LOG_ERROR(db, "error %s\n", "printed");
+	DBJ_LOG_CHK(error, db, 1 == 2);
+	DBJ_LOG_CHK(error, db, 1 == 1);
+	DBJ_LOG_CHK(trace, db, dbj_log_level_testing_call() == 0);
+	DBJ_VERIFY((dbj_log_level_testing_calls_ == 1));
+
+	DBJ_VERIFY((dbj::log::level_from_spec("net=trace,*=warn", "net") == DBJ_LOG_LEVEL_TRACE));
+	DBJ_VERIFY((dbj::log::level_from_spec("*=error,net=debug", "db") == DBJ_LOG_LEVEL_ERROR));
+	DBJ_VERIFY((dbj::log::level_from_spec("net=bogus", "net") == DBJ_LOG_DEFAULT_LEVEL));
+	return 0;
+}
+#endif // DBJ_LOG_LEVEL_TESTING
+
+#endif // DBJ_LOG_LEVEL_INC
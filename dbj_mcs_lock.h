@@ -0,0 +1,331 @@
+#ifndef DBJ_MCS_LOCK_INC
+#define DBJ_MCS_LOCK_INC
+
+/*
+(c) 2021 by dbj.org   -- LICENSE DBJ -- https://dbj.org/license_dbj/
+
+dbj nano mcs lock
+
+fair, FIFO, queue lock. Mellor-Crummey and Scott, 1991.
+
+with many threads on one lock, the nano mutex (and CRITICAL_SECTION, and
+std::mutex) waiters all look at the same lock word. each release makes
+that line bounce to every core and the winner is whoever is lucky, thus
+some threads wait much longer than the others.
+
+mcs waiters form the queue. each one spins on its own node, on its own
+cache line, and the lock is handed to the next in line. one line
+transfer per hand over, no matter how many threads wait, and nobody
+is starved.
+
+	dbj::nano::mcs_lock lock_;
+
+	{
+		// the node lives on the stack of the waiting thread
+		dbj::nano::mcs_lock::node node_;
+		lock_.lock(node_);
+		// ...
+		lock_.unlock(node_);
+	}
+
+	// or the dbj scoped guard, see dbj_nano_synchro.h
+	{
+		dbj::queue_lock_unlock guard_(lock_);
+	}
+
+lock() and unlock() without the node are there too, thus std::lock_guard
+works. the node is then taken from the small per thread pool.
+
+the waiter spins for a while then parks on its node, the same futex
+primitives as the nano mutex. the price of the fairness: the lock can not
+be stolen, the next in line might be preempted and everybody waits.
+for the low thread counts nano mutex is faster. measure.
+
+Note: this header does not depend on the rest of dbj, just on the
+dbj_nano_mutex.h
+*/
+
+#ifdef __clang__
+#pragma clang system_header
+#endif // __clang__
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+#include "dbj_nano_mutex.h"
+
+// nodes per thread for the lock() / unlock() without the node
+// that is how many mcs locks one thread can hold at once that way
+#ifndef DBJ_NANO_MCS_NODES
+#define DBJ_NANO_MCS_NODES 8
+#endif
+
+#undef DBJ_MCS_FAIL_POLICY
+// redefine this to return instead of exit() if required
+#define DBJ_MCS_FAIL_POLICY(MSG_)       \
+	perror(" (" __FILE__ ") " MSG_); \
+	exit(EXIT_FAILURE);
+
+namespace dbj::nano
+{
+	class mcs_lock final
+	{
+	public:
+		// one per waiter, must live until unlock() returns
+		struct alignas(DBJ_NANO_CACHE_LINE) node
+		{
+			std::atomic<node*> next{nullptr};
+			std::atomic<std::uint32_t> state{0};
+			// used by the per thread pool only
+			bool taken{false};
+		};
+
+	private:
+		enum : std::uint32_t
+		{
+			granted = 0,
+			waiting = 1,
+			parked = 2
+		};
+
+		alignas(DBJ_NANO_CACHE_LINE) std::atomic<node*> tail_{nullptr};
+		// lock() without the node, written and read by the owner only
+		node* owner_{nullptr};
+
+		static void wait_for_grant(node& node_) noexcept
+		{
+			for (unsigned spin_ = 0; spin_ < DBJ_NANO_MAX_SPIN; ++spin_)
+			{
+				if (node_.state.load(std::memory_order_acquire) == granted)
+					return;
+				DBJ_CPU_RELAX();
+			}
+			std::uint32_t expected_ = waiting;
+			if (!node_.state.compare_exchange_strong(expected_, parked, std::memory_order_acquire))
+				return; // granted in the meantime
+			while (node_.state.load(std::memory_order_acquire) == parked)
+				futex_wait(&node_.state, parked);
+		}
+
+		static node* take_node() noexcept
+		{
+			thread_local node pool_[DBJ_NANO_MCS_NODES]{};
+			for (node& node_ : pool_)
+				if (!node_.taken)
+				{
+					node_.taken = true;
+					return &node_;
+				}
+			DBJ_MCS_FAIL_POLICY("mcs_lock::lock() - out of the per thread nodes, increase DBJ_NANO_MCS_NODES");
+		}
+
+	public:
+		constexpr mcs_lock() noexcept = default;
+
+		mcs_lock(mcs_lock const&) = delete;
+		mcs_lock& operator=(mcs_lock const&) = delete;
+
+		void lock(node& node_) noexcept
+		{
+			node_.next.store(nullptr, std::memory_order_relaxed);
+			node_.state.store(waiting, std::memory_order_relaxed);
+
+			node* prev_ = tail_.exchange(&node_, std::memory_order_acq_rel);
+			if (prev_ == nullptr)
+				return; // nobody was there
+
+			prev_->next.store(&node_, std::memory_order_release);
+			wait_for_grant(node_);
+		}
+
+		bool try_lock(node& node_) noexcept
+		{
+			node_.next.store(nullptr, std::memory_order_relaxed);
+			node_.state.store(granted, std::memory_order_relaxed);
+			node* expected_ = nullptr;
+			// release, the node is published to the next one in line
+			return tail_.compare_exchange_strong(expected_, &node_,
+												 std::memory_order_acq_rel, std::memory_order_relaxed);
+		}
+
+		void unlock(node& node_) noexcept
+		{
+			node* next_ = node_.next.load(std::memory_order_acquire);
+			if (next_ == nullptr)
+			{
+				node* expected_ = &node_;
+				if (tail_.compare_exchange_strong(expected_, nullptr,
+												  std::memory_order_release, std::memory_order_relaxed))
+					return; // we were the last one
+
+				// the next one is in between the exchange and the link
+				unsigned spin_{0};
+				while ((next_ = node_.next.load(std::memory_order_acquire)) == nullptr)
+				{
+					if (++spin_ < DBJ_NANO_MAX_SPIN)
+						DBJ_CPU_RELAX();
+					else
+						std::this_thread::yield();
+				}
+			}
+			// DBJ NOTE: next_ might be gone as soon as it sees 'granted'
+			// waking up the stale address is harmless, parked waiters re-check
+			if (next_->state.exchange(granted, std::memory_order_release) == parked)
+				futex_wake_one(&next_->state);
+		}
+
+		// Lockable -----------------------------------------------------
+		// same thread must lock and unlock
+
+		void lock() noexcept
+		{
+			node* node_ = take_node();
+			lock(*node_);
+			owner_ = node_;
+		}
+
+		bool try_lock() noexcept
+		{
+			node* node_ = take_node();
+			if (!try_lock(*node_))
+			{
+				node_->taken = false;
+				return false;
+			}
+			owner_ = node_;
+			return true;
+		}
+
+		void unlock() noexcept
+		{
+			node* node_ = owner_;
+			owner_ = nullptr;
+			unlock(*node_);
+			node_->taken = false;
+		}
+
+		// racy by definition, for diagnostics only
+		bool is_locked() const noexcept
+		{
+			return tail_.load(std::memory_order_relaxed) != nullptr;
+		}
+	}; // mcs_lock
+
+} // namespace dbj::nano
+
+#undef DBJ_MCS_FAIL_POLICY
+
+#ifdef DBJ_MCS_LOCK_TESTING
+/*
+throughput and the wait time tail, by the number of threads, for
+std::mutex, the nano mutex and the mcs lock
+
+	clang++ -std=c++17 -O2 -DDBJ_MCS_LOCK_TESTING -x c++ dbj_mcs_lock.h
+	a.out [max threads]
+*/
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+namespace dbj::nano::mcs_testing
+{
+	inline std::uint64_t now_ns() noexcept
+	{
+		return static_cast<std::uint64_t>(
+			std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::steady_clock::now().time_since_epoch())
+				.count());
+	}
+
+	// small critical section, touches two lines
+	struct alignas(DBJ_NANO_CACHE_LINE) shared_state final
+	{
+		std::uint64_t counter{};
+		std::uint64_t payload[15]{};
+	};
+
+	/*
+	each thread does iterations_ lock, work, unlock
+	prints million ops per second and the wait time percentiles, in us
+	returns false if the counter is wrong
+	*/
+	template <typename L>
+	inline bool run(const char* title_, unsigned threads_, unsigned iterations_)
+	{
+		L lock_;
+		shared_state state_{};
+		std::atomic<bool> go_{false};
+		std::vector<std::vector<std::uint32_t>> waits_(threads_);
+		std::vector<std::thread> workers_;
+
+		for (unsigned t_ = 0; t_ < threads_; ++t_)
+			workers_.emplace_back([&, t_] {
+				auto& my_waits_ = waits_[t_];
+				my_waits_.reserve(iterations_);
+				while (!go_.load(std::memory_order_acquire))
+					std::this_thread::yield();
+				for (unsigned k = 0; k < iterations_; ++k)
+				{
+					const std::uint64_t start_ = now_ns();
+					lock_.lock();
+					my_waits_.push_back(std::uint32_t(std::min<std::uint64_t>(now_ns() - start_, UINT32_MAX)));
+					state_.counter += 1;
+					state_.payload[k % 15] += k;
+					lock_.unlock();
+				}
+			});
+
+		const std::uint64_t start_ = now_ns();
+		go_.store(true, std::memory_order_release);
+		for (auto& worker_ : workers_)
+			worker_.join();
+		const double seconds_ = (now_ns() - start_) / 1e9;
+
+		std::vector<std::uint32_t> all_;
+		all_.reserve(std::size_t(threads_) * iterations_);
+		for (auto& my_waits_ : waits_)
+			all_.insert(all_.end(), my_waits_.begin(), my_waits_.end());
+		std::sort(all_.begin(), all_.end());
+
+		auto percentile_ = [&](double p_) {
+			return all_.empty() ? 0.0 : all_[std::size_t(p_ * double(all_.size() - 1))] / 1000.0;
+		};
+
+		::printf("\n%-12s threads: %3u  Mops/s: %8.3f  wait us p50: %9.3f  p99: %9.3f  p99.9: %9.3f  max: %10.3f",
+				 title_, threads_, double(threads_) * iterations_ / seconds_ / 1e6,
+				 percentile_(0.5), percentile_(0.99), percentile_(0.999), percentile_(1.0));
+
+		return state_.counter == std::uint64_t(threads_) * iterations_;
+	}
+
+	inline bool scaling(unsigned max_threads_, unsigned iterations_ = 20000)
+	{
+		bool ok_ = true;
+		for (unsigned threads_ = 1; threads_ <= max_threads_; threads_ *= 2)
+		{
+			ok_ &= run<std::mutex>("std::mutex", threads_, iterations_);
+			ok_ &= run<mutex>("nano mutex", threads_, iterations_);
+			ok_ &= run<mcs_lock>("mcs lock", threads_, iterations_);
+			::printf("\n");
+		}
+		return ok_;
+	}
+} // namespace dbj::nano::mcs_testing
+
+int main(int argc, char** argv)
+{
+	unsigned max_threads_ = 2 * std::thread::hardware_concurrency();
+	if (argc > 1)
+		max_threads_ = unsigned(atoi(argv[1]));
+	if (max_threads_ < 1)
+		max_threads_ = 1;
+	return dbj::nano::mcs_testing::scaling(max_threads_) ? 0 : 1;
+}
+#endif // DBJ_MCS_LOCK_TESTING
+
+#endif // DBJ_MCS_LOCK_INC
@@ -0,0 +1,444 @@
+#ifndef DBJ_NANO_MUTEX_INC
+#define DBJ_NANO_MUTEX_INC
+
+/*
+(c) 2021 by dbj.org   -- LICENSE DBJ -- https://dbj.org/license_dbj/
+
+dbj nano mutex
+
+portable, lightweight, spin-then-park mutex. 8 bytes, the 4 bytes state
+word and the 4 bytes spin estimate.
+
+	0 -- unlocked
+	1 -- locked, nobody waits
+	2 -- locked, somebody might wait
+
+uncontended lock() is one compare exchange, uncontended unlock() is one
+exchange. contended lock() spins for a while, adapting the spin count to
+how long the lock is usually held, then parks the thread on the state
+word, with
+
+	Linux   -- futex(FUTEX_WAIT_PRIVATE)
+	Windows -- WaitOnAddress()  (Synchronization.lib)
+	other   -- yield loop
+
+Ulrich Drepper, "Futexes Are Tricky", mutex no 2. No constructor to run,
+zero is unlocked, thus usable as a static without init order issues.
+
+shared_mutex, bellow, is the reader-writer lock built on the same wait and
+wake primitives.
+
+Note: this header does not depend on the rest of dbj, so it can be used
+on its own.
+*/
+
+#ifdef __clang__
+#pragma clang system_header
+#endif // __clang__
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+
+#if defined(_WIN32)
+#include "dbj_windows_include.h"
+#pragma comment(lib, "Synchronization.lib")
+#define DBJ_NANO_FUTEX_WIN32 1
+#elif defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#define DBJ_NANO_FUTEX_LINUX 1
+#endif
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define DBJ_CPU_RELAX() _mm_pause()
+#elif defined(_M_ARM64) || defined(_M_ARM)
+#include <intrin.h>
+#define DBJ_CPU_RELAX() __yield()
+#elif defined(__aarch64__) || defined(__arm__)
+#define DBJ_CPU_RELAX() __asm__ __volatile__("yield")
+#else
+#define DBJ_CPU_RELAX() std::this_thread::yield()
+#endif
+
+#ifndef DBJ_NANO_MAX_SPIN
+#define DBJ_NANO_MAX_SPIN 100
+#endif
+
+#ifndef DBJ_NANO_CACHE_LINE
+#define DBJ_NANO_CACHE_LINE 64
+#endif
+
+// reader slots of the shared_mutex
+#ifndef DBJ_NANO_RW_SLOTS
+#define DBJ_NANO_RW_SLOTS 16
+#endif
+
+namespace dbj::nano
+{
+	/*
+	park the calling thread while *address_ == expected_
+	spurious wake ups are allowed, caller re-checks
+	*/
+	inline void futex_wait(std::atomic<std::uint32_t>* address_, std::uint32_t expected_) noexcept
+	{
+		static_assert(sizeof(std::atomic<std::uint32_t>) == sizeof(std::uint32_t));
+#if defined(DBJ_NANO_FUTEX_LINUX)
+		syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(address_), FUTEX_WAIT_PRIVATE, expected_, nullptr, nullptr, 0);
+#elif defined(DBJ_NANO_FUTEX_WIN32)
+		WaitOnAddress((volatile VOID*)address_, &expected_, sizeof(expected_), INFINITE);
+#else
+		if (address_->load(std::memory_order_relaxed) == expected_)
+			std::this_thread::yield();
+#endif
+	}
+
+	/*
+	as futex_wait() but for no longer than timeout_
+	caller re-checks and measures the time itself
+	*/
+	inline void futex_wait_for(std::atomic<std::uint32_t>* address_, std::uint32_t expected_,
+							   std::chrono::nanoseconds timeout_) noexcept
+	{
+		if (timeout_.count() <= 0)
+			return;
+#if defined(DBJ_NANO_FUTEX_LINUX)
+		timespec relative_{};
+		relative_.tv_sec = time_t(timeout_.count() / 1000000000);
+		relative_.tv_nsec = long(timeout_.count() % 1000000000);
+		syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(address_), FUTEX_WAIT_PRIVATE, expected_, &relative_, nullptr, 0);
+#elif defined(DBJ_NANO_FUTEX_WIN32)
+		// round up, 0 would not wait at all
+		const DWORD ms_ = DWORD((timeout_.count() + 999999) / 1000000);
+		WaitOnAddress((volatile VOID*)address_, &expected_, sizeof(expected_), ms_);
+#else
+		if (address_->load(std::memory_order_relaxed) == expected_)
+			std::this_thread::yield();
+#endif
+	}
+
+	// wake up one thread parked on the address_
+	inline void futex_wake_one(std::atomic<std::uint32_t>* address_) noexcept
+	{
+#if defined(DBJ_NANO_FUTEX_LINUX)
+		syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(address_), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+#elif defined(DBJ_NANO_FUTEX_WIN32)
+		WakeByAddressSingle((PVOID)address_);
+#else
+		(void)address_;
+#endif
+	}
+
+	// wake up all the threads parked on the address_
+	inline void futex_wake_all(std::atomic<std::uint32_t>* address_) noexcept
+	{
+#if defined(DBJ_NANO_FUTEX_LINUX)
+		syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(address_), FUTEX_WAKE_PRIVATE, INT32_MAX, nullptr, nullptr, 0);
+#elif defined(DBJ_NANO_FUTEX_WIN32)
+		WakeByAddressAll((PVOID)address_);
+#else
+		(void)address_;
+#endif
+	}
+
+	/*
+	meets the std TimedLockable requirements, thus std::lock_guard and
+	std::unique_lock work with it too
+	*/
+	class mutex final
+	{
+		enum : std::uint32_t
+		{
+			unlocked = 0,
+			locked = 1,
+			contended = 2
+		};
+
+		std::atomic<std::uint32_t> state_{unlocked};
+		// running estimate of the spins needed, glibc adaptive mutex style
+		std::atomic<std::uint32_t> spin_estimate_{0};
+
+		void lock_slow() noexcept
+		{
+			const std::uint32_t estimate_ = spin_estimate_.load(std::memory_order_relaxed);
+			std::uint32_t max_spin_ = estimate_ * 2 + 10;
+			if (max_spin_ > DBJ_NANO_MAX_SPIN)
+				max_spin_ = DBJ_NANO_MAX_SPIN;
+
+			for (std::uint32_t spin_ = 0; spin_ < max_spin_; ++spin_)
+			{
+				DBJ_CPU_RELAX();
+				if (state_.load(std::memory_order_relaxed) == unlocked)
+				{
+					std::uint32_t expected_ = unlocked;
+					if (state_.compare_exchange_weak(expected_, locked,
+													 std::memory_order_acquire, std::memory_order_relaxed))
+					{
+						spin_estimate_.store(estimate_ + (std::int32_t(spin_) - std::int32_t(estimate_)) / 8,
+											 std::memory_order_relaxed);
+						return;
+					}
+				}
+			}
+			spin_estimate_.store(estimate_ + (std::int32_t(max_spin_) - std::int32_t(estimate_)) / 8,
+								 std::memory_order_relaxed);
+
+			// park
+			// from now on the state is 'contended' since we can not know
+			// if there are other waiters
+			while (state_.exchange(contended, std::memory_order_acquire) != unlocked)
+				futex_wait(&state_, contended);
+		}
+
+	public:
+		constexpr mutex() noexcept = default;
+
+		mutex(mutex const&) = delete;
+		mutex& operator=(mutex const&) = delete;
+
+		void lock() noexcept
+		{
+			std::uint32_t expected_ = unlocked;
+			if (state_.compare_exchange_strong(expected_, locked,
+											   std::memory_order_acquire, std::memory_order_relaxed))
+				return;
+			lock_slow();
+		}
+
+		bool try_lock() noexcept
+		{
+			std::uint32_t expected_ = unlocked;
+			return state_.compare_exchange_strong(expected_, locked,
+												  std::memory_order_acquire, std::memory_order_relaxed);
+		}
+
+		// false on timeout
+		template <typename CLOCK, typename DURATION>
+		bool try_lock_until(std::chrono::time_point<CLOCK, DURATION> const& deadline_) noexcept
+		{
+			if (try_lock())
+				return true;
+
+			for (unsigned spin_ = 0; spin_ < DBJ_NANO_MAX_SPIN; ++spin_)
+			{
+				DBJ_CPU_RELAX();
+				if (try_lock())
+					return true;
+			}
+
+			// as in lock_slow()
+			while (state_.exchange(contended, std::memory_order_acquire) != unlocked)
+			{
+				const auto remaining_ = deadline_ - CLOCK::now();
+				if (remaining_ <= remaining_.zero())
+					return false;
+				futex_wait_for(&state_, contended,
+							   std::chrono::duration_cast<std::chrono::nanoseconds>(remaining_));
+			}
+			return true;
+		}
+
+		template <typename REP, typename PERIOD>
+		bool try_lock_for(std::chrono::duration<REP, PERIOD> const& timeout_) noexcept
+		{
+			return try_lock_until(std::chrono::steady_clock::now() + timeout_);
+		}
+
+		void unlock() noexcept
+		{
+			if (state_.exchange(unlocked, std::memory_order_release) == contended)
+				futex_wake_one(&state_);
+		}
+
+		// racy by definition, for diagnostics only
+		bool is_locked() const noexcept
+		{
+			return state_.load(std::memory_order_relaxed) != unlocked;
+		}
+	}; // mutex
+
+	// the state word and the spin estimate, nothing else
+	static_assert(sizeof(mutex) == 8, "dbj::nano::mutex -- expected to be 8 bytes");
+
+	/*
+	zero based index of the calling thread, given on the first call
+	the same for the life time of the thread, never reused
+	the one and only, dbj::alloc::this_thread_index is this one
+	*/
+	inline std::size_t this_thread_index() noexcept
+	{
+		static std::atomic<std::size_t> counter_{0};
+		thread_local const std::size_t index_ = counter_.fetch_add(1, std::memory_order_relaxed);
+		return index_;
+	}
+
+	/*
+	reader-writer lock for the read mostly state
+
+	readers do not share one counter, they are spread over the cache line
+	padded slots, by thread. thus readers on different cores do not bounce
+	the same line and read throughput scales with the number of cores.
+	the price is the writer, it has to look into all the slots.
+
+	PREFER_WRITERS == true
+		once the writer announces itself new readers wait. no writer
+		starvation, this is the default.
+	PREFER_WRITERS == false
+		the writer backs off while there are readers. readers are never
+		kept waiting by the writer which is only waiting.
+
+	lock_shared() and unlock_shared() must be called from the same thread.
+	meets the std SharedLockable requirements, std::shared_lock works too.
+	*/
+	template <bool PREFER_WRITERS = true, std::size_t SLOTS = DBJ_NANO_RW_SLOTS>
+	class basic_shared_mutex final
+	{
+		static_assert(SLOTS > 0);
+
+		struct alignas(DBJ_NANO_CACHE_LINE) reader_slot
+		{
+			std::atomic<std::uint32_t> readers{0};
+		};
+
+		reader_slot slots_[SLOTS]{};
+		// 1 -- writer is inside or wants to be
+		alignas(DBJ_NANO_CACHE_LINE) std::atomic<std::uint32_t> writer_{0};
+		// writers among themselves
+		mutex writers_{};
+		// the parking word, changed on every release somebody waits for
+		alignas(DBJ_NANO_CACHE_LINE) std::atomic<std::uint32_t> epoch_{0};
+		std::atomic<std::uint32_t> sleepers_{0};
+
+		reader_slot& my_slot() noexcept
+		{
+			return slots_[this_thread_index() % SLOTS];
+		}
+
+		bool no_readers() const noexcept
+		{
+			for (auto const& slot_ : slots_)
+				if (slot_.readers.load() != 0)
+					return false;
+			return true;
+		}
+
+		bool no_writer() const noexcept { return writer_.load() == 0; }
+
+		void wake() noexcept
+		{
+			if (sleepers_.load() > 0)
+			{
+				epoch_.fetch_add(1);
+				futex_wake_all(&epoch_);
+			}
+		}
+
+		// spin then park until ready_() or a wake up
+		// caller re-checks
+		template <typename PRED>
+		void wait_until(PRED ready_) noexcept
+		{
+			for (unsigned spin_ = 0; spin_ < DBJ_NANO_MAX_SPIN; ++spin_)
+			{
+				if (ready_())
+					return;
+				DBJ_CPU_RELAX();
+			}
+			sleepers_.fetch_add(1);
+			const std::uint32_t epoch_seen_ = epoch_.load();
+			if (!ready_())
+				futex_wait(&epoch_, epoch_seen_);
+			sleepers_.fetch_sub(1);
+		}
+
+	public:
+		constexpr basic_shared_mutex() noexcept = default;
+
+		basic_shared_mutex(basic_shared_mutex const&) = delete;
+		basic_shared_mutex& operator=(basic_shared_mutex const&) = delete;
+
+		// shared ------------------------------------------------------
+
+		bool try_lock_shared() noexcept
+		{
+			if (!no_writer())
+				return false;
+			reader_slot& slot_ = my_slot();
+			slot_.readers.fetch_add(1);
+			if (no_writer())
+				return true;
+			// writer came in between
+			slot_.readers.fetch_sub(1);
+			wake();
+			return false;
+		}
+
+		void lock_shared() noexcept
+		{
+			while (!try_lock_shared())
+				wait_until([this] { return no_writer(); });
+		}
+
+		void unlock_shared() noexcept
+		{
+			my_slot().readers.fetch_sub(1);
+			// the backing off writer is not in writer_ any more
+			// thus check for the sleepers, not for the writer
+			wake();
+		}
+
+		// exclusive ---------------------------------------------------
+
+		bool try_lock() noexcept
+		{
+			if (!writers_.try_lock())
+				return false;
+			writer_.store(1);
+			if (no_readers())
+				return true;
+			writer_.store(0);
+			wake();
+			writers_.unlock();
+			return false;
+		}
+
+		void lock() noexcept
+		{
+			writers_.lock();
+			writer_.store(1);
+			while (!no_readers())
+			{
+				if constexpr (!PREFER_WRITERS)
+				{
+					// let the readers in, wait for them to go away
+					writer_.store(0);
+					wake();
+					wait_until([this] { return no_readers(); });
+					writer_.store(1);
+				}
+				else
+				{
+					wait_until([this] { return no_readers(); });
+				}
+			}
+		}
+
+		void unlock() noexcept
+		{
+			writer_.store(0);
+			wake();
+			writers_.unlock();
+		}
+	}; // basic_shared_mutex
+
+	using shared_mutex = basic_shared_mutex<true>;
+	using reader_preferring_shared_mutex = basic_shared_mutex<false>;
+
+} // namespace dbj::nano
+
+#endif // DBJ_NANO_MUTEX_INC
@@ -6,19 +6,31 @@
 */
 
 #include "dbj_common.h"
-#include "dbj_windows_include.h"
+#include "dbj_nano_mutex.h"
+#include "dbj_mcs_lock.h"
+#include "dbj_lock_stats.h"
+
+#ifdef __cplusplus
+#include <chrono>
+#include <thread>
+#include <type_traits>
+#endif // __cplusplus
 
 /*
-ONE SINGLE PER PROCESS dbj nano critical section
+ONE SINGLE PER PROCESS dbj nano lock
 Thus using it in one place locks eveything else using it in every other place!
 
-Note: this is obviously WIN32 only and we are starting with C code
-*/
+If you do not need that, use the striped lock table, bellow.
 
-#ifdef __cplusplus
-extern "C"
-{
-#endif // __cplusplus
+All the locks in here are dbj::nano::mutex, see dbj_nano_mutex.h
+Thus this is not WIN32 only any more. The synchro_* functions bellow are
+in the C style, but they are C++: references, templates, lambdas. There is
+no C linkage, this header is C++ only.
+
+Define DBJ_LOCK_STATS for the lock contention statistics, see dbj_lock_stats.h
+The *_at(site) variants bellow are for the call site records, the autolock
+macros use them. Without DBJ_LOCK_STATS site is always nullptr.
+*/
 
 // /kernel CL switch macro
 #ifdef _KERNEL_MODE
@@ -43,94 +55,510 @@ NOTE! __declspec(thread) is not supported with /kernel
 #define DBJ_THREADLOCAL
 #endif
 
-        int __cdecl atexit(void(__cdecl *)(void));
-
     /// we need to make common functions work in presence of multiple threads
+    /// zero is unlocked, thus no initialization and no atexit() cleanup
     typedef struct
     {
-        bool initalized;
-        CRITICAL_SECTION crit_sect;
+        dbj::nano::mutex mutex_;
+        DBJ_LOCK_STATS_MEMBER("global lock")
     } dbj_nano_synchro_type;
 
-    dbj_nano_synchro_type *dbj_nano_crit_sect_initor();
+    inline dbj_nano_synchro_type *dbj_nano_crit_sect_initor()
+    {
+        // this means: one per process
+        static dbj_nano_synchro_type synchro_;
+        return &synchro_;
+    }
 
-    inline void exit_common(void)
+    // these are system wide
+    inline void synchro_enter_at(dbj::lock_stats::record *site_)
     {
-        dbj_nano_synchro_type crit_ = *dbj_nano_crit_sect_initor();
+        dbj_nano_synchro_type *synchro_ = dbj_nano_crit_sect_initor();
+        dbj::lock_stats::lock_owned(synchro_->mutex_, DBJ_LOCK_STATS_OF(*synchro_), site_);
+    }
+    inline void synchro_enter() { synchro_enter_at(nullptr); }
+    inline void synchro_leave()
+    {
+        dbj_nano_synchro_type *synchro_ = dbj_nano_crit_sect_initor();
+        dbj::lock_stats::unlock_owned(synchro_->mutex_, DBJ_LOCK_STATS_OF(*synchro_));
+    }
 
-        if (crit_.initalized)
-        {
-            DeleteCriticalSection(&crit_.crit_sect);
-            crit_.initalized = false;
-        }
+    /*
+    striped lock table
+
+    the global lock above locks everything. the stripes are a fixed table
+    of locks, the key (object address or the caller chosen number) selects
+    one. thus unrelated subsystems do not contend, unless they happen to
+    hash to the same stripe.
+
+    each stripe is on its own cache line
+    */
+#ifndef DBJ_NANO_LOCK_STRIPES
+#define DBJ_NANO_LOCK_STRIPES 64
+#endif
+
+    static_assert(DBJ_NANO_LOCK_STRIPES > 1 && (DBJ_NANO_LOCK_STRIPES & (DBJ_NANO_LOCK_STRIPES - 1)) == 0,
+                  "DBJ_NANO_LOCK_STRIPES must be the power of two, bigger than 1");
+
+    typedef struct
+    {
+        alignas(DBJ_NANO_CACHE_LINE) dbj::nano::mutex mutex_;
+        DBJ_LOCK_STATS_MEMBER("stripe")
+    } dbj_nano_stripe_type;
+
+    typedef struct
+    {
+        dbj_nano_stripe_type stripes[DBJ_NANO_LOCK_STRIPES];
+    } dbj_nano_stripes_type;
+
+    inline dbj_nano_stripes_type *dbj_nano_stripes_initor()
+    {
+        // one table per process
+        static dbj_nano_stripes_type table_;
+#ifdef DBJ_LOCK_STATS
+        static bool indexed_ = [] {
+            for (int k = 0; k < DBJ_NANO_LOCK_STRIPES; ++k)
+                table_.stripes[k].stats_.index = k;
+            return true;
+        }();
+        (void)indexed_;
+#endif // DBJ_LOCK_STATS
+        return &table_;
     }
 
-    inline dbj_nano_synchro_type *dbj_nano_crit_sect_initor()
+    // log2(DBJ_NANO_LOCK_STRIPES)
+    constexpr inline unsigned dbj_nano_stripes_bits()
     {
-        // this means: one per process
-        static dbj_nano_synchro_type synchro_ = {false};
-        if (!synchro_.initalized)
-        {
-            InitializeCriticalSection(&synchro_.crit_sect);
-            synchro_.initalized = true;
-            atexit(exit_common);
-        }
+        unsigned bits_ = 0;
+        while ((1ull << bits_) < (unsigned long long)DBJ_NANO_LOCK_STRIPES)
+            ++bits_;
+        return bits_;
+    }
 
-        return &synchro_;
+    /*
+    fibonacci hashing of the key to the stripe index
+    the top bits of the product depend on all the bits of the key, thus the
+    aligned addresses, page or 64KB apart, still spread over all the stripes
+    */
+    inline size_t synchro_stripe_index(size_t key_)
+    {
+        return (size_t)(((uint64_t)key_ * 0x9E3779B97F4A7C15ull) >> (64 - dbj_nano_stripes_bits()));
     }
 
-    // these are system wide
-    inline void synchro_enter() { EnterCriticalSection(&dbj_nano_crit_sect_initor()->crit_sect); }
-    inline void synchro_leave() { LeaveCriticalSection(&dbj_nano_crit_sect_initor()->crit_sect); }
+    inline void synchro_enter_key_at(size_t key_, dbj::lock_stats::record *site_)
+    {
+        dbj_nano_stripe_type &stripe_ = dbj_nano_stripes_initor()->stripes[synchro_stripe_index(key_)];
+        dbj::lock_stats::lock_owned(stripe_.mutex_, DBJ_LOCK_STATS_OF(stripe_), site_);
+    }
+
+    inline void synchro_enter_key(size_t key_) { synchro_enter_key_at(key_, nullptr); }
+
+    inline void synchro_leave_key(size_t key_)
+    {
+        dbj_nano_stripe_type &stripe_ = dbj_nano_stripes_initor()->stripes[synchro_stripe_index(key_)];
+        dbj::lock_stats::unlock_owned(stripe_.mutex_, DBJ_LOCK_STATS_OF(stripe_));
+    }
+
+    /*
+    process wide reader-writer lock
+    for the read mostly global state, readers do not serialize
+    */
+    typedef struct
+    {
+        dbj::nano::shared_mutex shared_;
+        DBJ_LOCK_STATS_MEMBER("global shared lock")
+    } dbj_nano_shared_type;
+
+    inline dbj_nano_shared_type *dbj_nano_shared_initor()
+    {
+        static dbj_nano_shared_type shared_;
+        return &shared_;
+    }
+
+    inline void synchro_enter_shared_at(dbj::lock_stats::record *site_)
+    {
+        dbj_nano_shared_type *shared_ = dbj_nano_shared_initor();
+        (void)dbj::lock_stats::lock_shared(shared_->shared_, DBJ_LOCK_STATS_OF(*shared_), site_);
+    }
+    inline void synchro_enter_shared() { synchro_enter_shared_at(nullptr); }
+    inline void synchro_leave_shared()
+    {
+        dbj_nano_shared_type *shared_ = dbj_nano_shared_initor();
+        dbj::lock_stats::unlock_shared(shared_->shared_, DBJ_LOCK_STATS_OF(*shared_), nullptr, 0);
+    }
+    inline void synchro_enter_exclusive_at(dbj::lock_stats::record *site_)
+    {
+        dbj_nano_shared_type *shared_ = dbj_nano_shared_initor();
+        dbj::lock_stats::lock_owned(shared_->shared_, DBJ_LOCK_STATS_OF(*shared_), site_);
+    }
+    inline void synchro_enter_exclusive() { synchro_enter_exclusive_at(nullptr); }
+    inline void synchro_leave_exclusive()
+    {
+        dbj_nano_shared_type *shared_ = dbj_nano_shared_initor();
+        dbj::lock_stats::unlock_owned(shared_->shared_, DBJ_LOCK_STATS_OF(*shared_));
+    }
+
+    // caller owned locks share this one record
+    inline dbj::lock_stats::record *dbj_nano_caller_owned_stats()
+    {
+#ifdef DBJ_LOCK_STATS
+        static dbj::lock_stats::record stats_{"caller owned lock"};
+        return &stats_;
+#else
+        return nullptr;
+#endif // DBJ_LOCK_STATS
+    }
+
+    // key is the object address
+    inline void synchro_enter_address(const void *address_) { synchro_enter_key((size_t)address_); }
+    inline void synchro_leave_address(const void *address_) { synchro_leave_key((size_t)address_); }
 
 #ifdef DBJ_LIB_MT
 #define DBJ_LIB_SYNC_ENTER synchro_enter()
 #define DBJ_LIB_SYNC_LEAVE synchro_leave()
+#define DBJ_LIB_SYNC_ENTER_KEY(K_) synchro_enter_key((size_t)(K_))
+#define DBJ_LIB_SYNC_LEAVE_KEY(K_) synchro_leave_key((size_t)(K_))
 #else
 #define DBJ_LIB_SYNC_ENTER
 #define DBJ_LIB_SYNC_LEAVE
+#define DBJ_LIB_SYNC_ENTER_KEY(K_)
+#define DBJ_LIB_SYNC_LEAVE_KEY(K_)
 #endif
 
-#ifdef __cplusplus
-} // extern "C"
-#endif // __cplusplus
-
 ///	-----------------------------------------------------------------------------------------
 #ifdef __cplusplus
 #pragma region cpp oo sinchronisation
 DBJ_NSPACE_BEGIN
 
-struct local_lock_unlock final : private no_copy_no_move
+/*
+WARNING: when this locks, nothing else on the process level can leave 
+the synchro_enter(); function
+*/
+struct global_lock_unlock final : private no_copy_no_move
+{
+    explicit global_lock_unlock(lock_stats::record *site_ = nullptr) noexcept
+    {
+        synchro_enter_at(site_);
+    }
+    ~global_lock_unlock() noexcept
+    {
+        synchro_leave();
+    }
+};
+
+/*
+locks only the stripe the key maps to
+
+    dbj::striped_lock_unlock autolock_(this) ; // object address as the key
+    dbj::striped_lock_unlock autolock_(42u) ;  // caller chosen key
+*/
+struct striped_lock_unlock final : private no_copy_no_move
 {
-    explicit local_lock_unlock() noexcept
+    explicit striped_lock_unlock(const void *address_, lock_stats::record *site_ = nullptr) noexcept
+        : key_((size_t)address_)
+    {
+        synchro_enter_key_at(key_, site_);
+    }
+    explicit striped_lock_unlock(size_t key_arg_, lock_stats::record *site_ = nullptr) noexcept
+        : key_(key_arg_)
     {
-        InitializeCriticalSection(&crit_sect_);
-        EnterCriticalSection(&crit_sect_);
+        synchro_enter_key_at(key_, site_);
     }
-    ~local_lock_unlock() noexcept
+    ~striped_lock_unlock() noexcept
     {
-        DeleteCriticalSection(&crit_sect_);
-        LeaveCriticalSection(&crit_sect_);
+        synchro_leave_key(key_);
     }
 
 private:
-    CRITICAL_SECTION crit_sect_{};
+    const size_t key_;
 };
 
 /*
-WARNING: when this locks, nothing else on the process level can leave 
-the synchro_enter(); function
+reader side of the process wide reader-writer lock
+or of the one given
 */
-struct global_lock_unlock final : private no_copy_no_move
+struct shared_lock_unlock final : private no_copy_no_move
 {
-    explicit global_lock_unlock() noexcept
+    explicit shared_lock_unlock(lock_stats::record *site_arg_ = nullptr) noexcept
+        : shared_(dbj_nano_shared_initor()->shared_),
+          stats_(DBJ_LOCK_STATS_OF(*dbj_nano_shared_initor())), site_(site_arg_)
     {
-        synchro_enter();
+        since_ = lock_stats::lock_shared(shared_, stats_, site_);
     }
-    ~global_lock_unlock() noexcept
+    explicit shared_lock_unlock(nano::shared_mutex &shared_arg_, lock_stats::record *site_arg_ = nullptr) noexcept
+        : shared_(shared_arg_), stats_(dbj_nano_caller_owned_stats()), site_(site_arg_)
     {
-        synchro_leave();
+        since_ = lock_stats::lock_shared(shared_, stats_, site_);
+    }
+    ~shared_lock_unlock() noexcept
+    {
+        lock_stats::unlock_shared(shared_, stats_, site_, since_);
     }
+
+private:
+    nano::shared_mutex &shared_;
+    lock_stats::record *stats_{};
+    lock_stats::record *site_{};
+    std::uint64_t since_{};
+};
+
+/*
+writer side of the process wide reader-writer lock
+or of the one given
+*/
+struct exclusive_lock_unlock final : private no_copy_no_move
+{
+    explicit exclusive_lock_unlock(lock_stats::record *site_arg_ = nullptr) noexcept
+        : shared_(dbj_nano_shared_initor()->shared_),
+          stats_(DBJ_LOCK_STATS_OF(*dbj_nano_shared_initor())), site_(site_arg_)
+    {
+        since_ = lock_stats::lock_exclusive(shared_, stats_, site_);
+    }
+    explicit exclusive_lock_unlock(nano::shared_mutex &shared_arg_, lock_stats::record *site_arg_ = nullptr) noexcept
+        : shared_(shared_arg_), stats_(dbj_nano_caller_owned_stats()), site_(site_arg_)
+    {
+        since_ = lock_stats::lock_exclusive(shared_, stats_, site_);
+    }
+    ~exclusive_lock_unlock() noexcept
+    {
+        lock_stats::unlock_exclusive(shared_, stats_, site_, since_);
+    }
+
+private:
+    nano::shared_mutex &shared_;
+    lock_stats::record *stats_{};
+    lock_stats::record *site_{};
+    std::uint64_t since_{};
+};
+
+/*
+scoped lock over the caller owned lock object
+any Lockable, dbj::nano::mutex, dbj::nano::mcs_lock, std::mutex ...
+
+    dbj::lock_unlock autolock_(my_mutex_) ;                    // blocks
+
+    dbj::lock_unlock autolock_(my_mutex_, dbj::try_to_lock) ;  // one attempt
+    if (!autolock_) return back_off_ ;
+
+    dbj::lock_unlock autolock_(my_mutex_, std::chrono::microseconds(50)) ;
+    if (!autolock_) return back_off_ ;
+
+lock_unlock_shared is the same, for the reader side of the SharedLockable,
+dbj::nano::shared_mutex, std::shared_mutex ...
+
+timed acquisition uses try_lock_for() / try_lock_shared_for() if the lock
+has it, dbj::nano::mutex does. otherwise it is try_lock() in the spin then
+yield loop, until the deadline. for the mcs_lock that means no place in
+the queue while trying.
+*/
+struct try_to_lock_type final
+{
+    explicit try_to_lock_type() = default;
+};
+inline constexpr try_to_lock_type try_to_lock{};
+
+namespace detail
+{
+template <typename L, typename = void>
+struct has_try_lock_for : std::false_type
+{
+};
+template <typename L>
+struct has_try_lock_for<L, std::void_t<decltype(std::declval<L &>().try_lock_for(std::chrono::nanoseconds{}))>>
+    : std::true_type
+{
+};
+
+template <typename L, typename = void>
+struct has_try_lock_shared_for : std::false_type
+{
+};
+template <typename L>
+struct has_try_lock_shared_for<L, std::void_t<decltype(std::declval<L &>().try_lock_shared_for(std::chrono::nanoseconds{}))>>
+    : std::true_type
+{
+};
+
+// the lock or the reader side of it, as one Lockable
+template <typename L, bool SHARED>
+struct access final
+{
+    L &lock_;
+
+    bool try_lock() noexcept
+    {
+        if constexpr (SHARED)
+            return lock_.try_lock_shared();
+        else
+            return lock_.try_lock();
+    }
+
+    void lock() noexcept
+    {
+        if constexpr (SHARED)
+            lock_.lock_shared();
+        else
+            lock_.lock();
+    }
+
+    void unlock() noexcept
+    {
+        if constexpr (SHARED)
+            lock_.unlock_shared();
+        else
+            lock_.unlock();
+    }
+
+    bool try_lock_for(std::chrono::nanoseconds timeout_) noexcept
+    {
+        if constexpr (SHARED && has_try_lock_shared_for<L>::value)
+            return lock_.try_lock_shared_for(timeout_);
+        else if constexpr (!SHARED && has_try_lock_for<L>::value)
+            return lock_.try_lock_for(timeout_);
+        else
+        {
+            const auto deadline_ = std::chrono::steady_clock::now() + timeout_;
+            for (unsigned spin_ = 0;; ++spin_)
+            {
+                if (try_lock())
+                    return true;
+                if (std::chrono::steady_clock::now() >= deadline_)
+                    return false;
+                if (spin_ < DBJ_NANO_MAX_SPIN)
+                    DBJ_CPU_RELAX();
+                else
+                    std::this_thread::yield();
+            }
+        }
+    }
+};
+
+template <typename L, bool SHARED>
+class basic_lock_unlock : private no_copy_no_move
+{
+    access<L, SHARED> access_;
+    lock_stats::record *stats_{};
+    lock_stats::record *site_{};
+    std::uint64_t since_{};
+    bool owns_{};
+
+public:
+    // blocks
+    explicit basic_lock_unlock(L &lock_arg_, lock_stats::record *site_arg_ = nullptr) noexcept
+        : access_{lock_arg_}, stats_(dbj_nano_caller_owned_stats()), site_(site_arg_)
+    {
+        if constexpr (SHARED)
+            since_ = lock_stats::lock_shared(lock_arg_, stats_, site_);
+        else
+            since_ = lock_stats::lock_exclusive(access_, stats_, site_);
+        owns_ = true;
+    }
+
+    // one attempt
+    basic_lock_unlock(L &lock_arg_, try_to_lock_type, lock_stats::record *site_arg_ = nullptr) noexcept
+        : access_{lock_arg_}, stats_(dbj_nano_caller_owned_stats()), site_(site_arg_)
+    {
+        owns_ = access_.try_lock();
+        if (owns_)
+            since_ = lock_stats::on_acquired(stats_, site_, 0, false);
+    }
+
+    // no longer than timeout_
+    template <typename REP, typename PERIOD>
+    basic_lock_unlock(L &lock_arg_, std::chrono::duration<REP, PERIOD> timeout_,
+                      lock_stats::record *site_arg_ = nullptr) noexcept
+        : access_{lock_arg_}, stats_(dbj_nano_caller_owned_stats()), site_(site_arg_)
+    {
+        if (access_.try_lock())
+        {
+            owns_ = true;
+            since_ = lock_stats::on_acquired(stats_, site_, 0, false);
+            return;
+        }
+        const std::uint64_t start_ = lock_stats::now_ns();
+        owns_ = access_.try_lock_for(std::chrono::duration_cast<std::chrono::nanoseconds>(timeout_));
+        if (owns_)
+            since_ = lock_stats::on_acquired(stats_, site_, lock_stats::now_ns() - start_, true);
+    }
+
+    ~basic_lock_unlock() noexcept
+    {
+        unlock();
+    }
+
+    bool owns_lock() const noexcept { return owns_; }
+    explicit operator bool() const noexcept { return owns_; }
+
+    // before the end of the scope
+    void unlock() noexcept
+    {
+        if (!owns_)
+            return;
+        owns_ = false;
+        if constexpr (SHARED)
+            lock_stats::unlock_shared(access_.lock_, stats_, site_, since_);
+        else
+            lock_stats::unlock_exclusive(access_, stats_, site_, since_);
+    }
+};
+} // namespace detail
+
+template <typename L>
+struct lock_unlock final : detail::basic_lock_unlock<L, false>
+{
+    using detail::basic_lock_unlock<L, false>::basic_lock_unlock;
+};
+
+template <typename L>
+struct lock_unlock_shared final : detail::basic_lock_unlock<L, true>
+{
+    using detail::basic_lock_unlock<L, true>::basic_lock_unlock;
+};
+
+template <typename L, typename... A>
+lock_unlock(L &, A &&...) -> lock_unlock<L>;
+template <typename L, typename... A>
+lock_unlock_shared(L &, A &&...) -> lock_unlock_shared<L>;
+
+// DBJ NOTE: this used to own its own lock, thus it was locking nobody out
+// it is now the lock_unlock over the caller given nano mutex
+using local_lock_unlock = lock_unlock<nano::mutex>;
+
+/*
+fair, FIFO, for the many threads on one lock, see dbj_mcs_lock.h
+the queue node lives in the guard, thus on the waiting thread stack
+
+    static dbj::nano::mcs_lock hot_lock_ ;
+    dbj::queue_lock_unlock autolock_(hot_lock_) ;
+*/
+struct queue_lock_unlock final : private no_copy_no_move
+{
+    explicit queue_lock_unlock(nano::mcs_lock &lock_arg_, lock_stats::record *site_arg_ = nullptr) noexcept
+        : queued_{lock_arg_}, stats_(dbj_nano_caller_owned_stats()), site_(site_arg_)
+    {
+        since_ = lock_stats::lock_exclusive(queued_, stats_, site_);
+    }
+    ~queue_lock_unlock() noexcept
+    {
+        lock_stats::unlock_exclusive(queued_, stats_, site_, since_);
+    }
+
+private:
+    // the lock and our node, as one Lockable
+    struct queued final
+    {
+        nano::mcs_lock &queue_;
+        nano::mcs_lock::node node_{};
+
+        bool try_lock() noexcept { return queue_.try_lock(node_); }
+        void lock() noexcept { queue_.lock(node_); }
+        void unlock() noexcept { queue_.unlock(node_); }
+    };
+
+    queued queued_;
+    lock_stats::record *stats_{};
+    lock_stats::record *site_{};
+    std::uint64_t since_{};
 };
 
 DBJ_NSPACE_END
@@ -139,21 +567,91 @@ DBJ_NSPACE_END
 
 #undef DBJ_LIB_AUTOLOCK_LOCAL
 #undef DBJ_LIB_AUTOLOCK_GLOBAL
+#undef DBJ_LIB_AUTOLOCK_KEY
+#undef DBJ_LIB_AUTOLOCK_SHARED
+#undef DBJ_LIB_AUTOLOCK_EXCLUSIVE
+#undef DBJ_LIB_AUTOLOCK_QUEUE
+#undef DBJ_LIB_AUTOLOCK_READ
 #undef DBJ_AUTOLOCK_UNAME_1
 #undef DBJ_AUTOLOCK_UNAME_2
 #undef DBJ_AUTOLOCK_UNAME_3
+#undef DBJ_AUTOLOCK_SITE_
+#undef DBJ_AUTOLOCK_SITE_KEY_
 
 #ifdef DBJ_LIB_MT
 #define DBJ_AUTOLOCK_UNAME_1(x, y) x##y
 #define DBJ_AUTOLOCK_UNAME_2(x, y) DBJ_AUTOLOCK_UNAME_1(x, y)
 #define DBJ_AUTOLOCK_UNAME_3(x)    DBJ_AUTOLOCK_UNAME_2(x, __COUNTER__)
-#define DBJ_LIB_AUTOLOCK_LOCAL dbj::lock_unlock DBJ_AUTOLOCK_UNAME_3(autolock_)
+#ifndef DBJ_LOCK_STATS
+// L_ is the caller owned lock
+#define DBJ_LIB_AUTOLOCK_LOCAL(L_) dbj::lock_unlock DBJ_AUTOLOCK_UNAME_3(local_autolock_)(L_)
+#define DBJ_LIB_AUTOLOCK_READ(L_) dbj::lock_unlock_shared DBJ_AUTOLOCK_UNAME_3(read_autolock_)(L_)
 #define DBJ_LIB_AUTOLOCK_GLOBAL dbj::global_lock_unlock DBJ_AUTOLOCK_UNAME_3(global_autolock_)
+// K_ is the object address or the caller chosen size_t key
+#define DBJ_LIB_AUTOLOCK_KEY(K_) dbj::striped_lock_unlock DBJ_AUTOLOCK_UNAME_3(striped_autolock_)(K_)
+// process wide reader-writer lock
+#define DBJ_LIB_AUTOLOCK_SHARED dbj::shared_lock_unlock DBJ_AUTOLOCK_UNAME_3(shared_autolock_)
+#define DBJ_LIB_AUTOLOCK_EXCLUSIVE dbj::exclusive_lock_unlock DBJ_AUTOLOCK_UNAME_3(exclusive_autolock_)
+// L_ is the dbj::nano::mcs_lock
+#define DBJ_LIB_AUTOLOCK_QUEUE(L_) dbj::queue_lock_unlock DBJ_AUTOLOCK_UNAME_3(queue_autolock_)(L_)
+#else // DBJ_LOCK_STATS
+// one static call site record per macro expansion
+#define DBJ_AUTOLOCK_SITE_(GUARD_, N_)                                                            \
+    static ::dbj::lock_stats::record DBJ_AUTOLOCK_UNAME_2(autolock_site_, N_){__FILE__, __LINE__}; \
+    GUARD_ DBJ_AUTOLOCK_UNAME_2(autolock_, N_)(&DBJ_AUTOLOCK_UNAME_2(autolock_site_, N_))
+#define DBJ_AUTOLOCK_SITE_KEY_(GUARD_, N_, K_)                                                    \
+    static ::dbj::lock_stats::record DBJ_AUTOLOCK_UNAME_2(autolock_site_, N_){__FILE__, __LINE__}; \
+    GUARD_ DBJ_AUTOLOCK_UNAME_2(autolock_, N_)(K_, &DBJ_AUTOLOCK_UNAME_2(autolock_site_, N_))
+#define DBJ_LIB_AUTOLOCK_LOCAL(L_) DBJ_AUTOLOCK_SITE_KEY_(dbj::lock_unlock, __COUNTER__, L_)
+#define DBJ_LIB_AUTOLOCK_READ(L_) DBJ_AUTOLOCK_SITE_KEY_(dbj::lock_unlock_shared, __COUNTER__, L_)
+#define DBJ_LIB_AUTOLOCK_GLOBAL DBJ_AUTOLOCK_SITE_(dbj::global_lock_unlock, __COUNTER__)
+#define DBJ_LIB_AUTOLOCK_KEY(K_) DBJ_AUTOLOCK_SITE_KEY_(dbj::striped_lock_unlock, __COUNTER__, K_)
+#define DBJ_LIB_AUTOLOCK_SHARED DBJ_AUTOLOCK_SITE_(dbj::shared_lock_unlock, __COUNTER__)
+#define DBJ_LIB_AUTOLOCK_EXCLUSIVE DBJ_AUTOLOCK_SITE_(dbj::exclusive_lock_unlock, __COUNTER__)
+#define DBJ_LIB_AUTOLOCK_QUEUE(L_) DBJ_AUTOLOCK_SITE_KEY_(dbj::queue_lock_unlock, __COUNTER__, L_)
+#endif // DBJ_LOCK_STATS
 #else
-#define DBJ_LIB_AUTOLOCK_LOCAL
+#define DBJ_LIB_AUTOLOCK_LOCAL(L_)
+#define DBJ_LIB_AUTOLOCK_READ(L_)
 #define DBJ_LIB_AUTOLOCK_GLOBAL
+#define DBJ_LIB_AUTOLOCK_KEY(K_)
+#define DBJ_LIB_AUTOLOCK_SHARED
+#define DBJ_LIB_AUTOLOCK_EXCLUSIVE
+#define DBJ_LIB_AUTOLOCK_QUEUE(L_)
 #endif
 
+#ifdef DBJ_NANO_SYNCHRO_TESTING
+/*
+the striped lock table distribution, over the aligned keys
+
+	clang++ -std=c++17 -DDBJ_NANO_SYNCHRO_TESTING -x c++ dbj_nano_synchro.h
+*/
+int main()
+{
+    // the allocation like strides: cache line, page, 64KB, 128KB, 1MB
+    const unsigned shifts_[]{6, 12, 16, 17, 20};
+    for (unsigned shift_ : shifts_)
+    {
+        unsigned hits_[DBJ_NANO_LOCK_STRIPES]{};
+        const unsigned keys_ = 16 * DBJ_NANO_LOCK_STRIPES;
+        for (size_t k = 0; k < keys_; ++k)
+            ++hits_[synchro_stripe_index(k << shift_)];
 
+        unsigned used_ = 0, most_ = 0;
+        for (unsigned hit_ : hits_)
+        {
+            used_ += hit_ ? 1 : 0;
+            most_ = hit_ > most_ ? hit_ : most_;
+        }
+        ::printf("\n%u keys, 2^%-2u apart: %3u of %u stripes used, the busiest has %u",
+                 keys_, shift_, used_, DBJ_NANO_LOCK_STRIPES, most_);
+        // all the stripes used, none with more than twice the fair share
+        DBJ_VERIFY((used_ == DBJ_NANO_LOCK_STRIPES));
+        DBJ_VERIFY((most_ <= 2 * keys_ / DBJ_NANO_LOCK_STRIPES));
+    }
+    ::printf("\n");
+    return 0;
+}
+#endif // DBJ_NANO_SYNCHRO_TESTING
 
 #endif // !DBJ_SYNHRO_INC
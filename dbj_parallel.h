@@ -0,0 +1,360 @@
+#ifndef DBJ_PARALLEL_INC
+#define DBJ_PARALLEL_INC
+
+/*
+(c) 2021 by dbj.org   -- LICENSE DBJ -- https://dbj.org/license_dbj/
+
+dbj data parallel algorithms, on the dbj task pool
+
+	DBJ_ARRAY<float, 4096> samples_ ;
+	not_a_vector<char> text_ ;
+
+	dbj::parallel::for_each(samples_, [](float & s_) { s_ *= 0.5f; });
+
+	auto checksum_ = dbj::parallel::reduce(text_, 0u,
+		[](unsigned acc_, char c_) { return acc_ + (unsigned char)c_; });
+
+	dbj::parallel::transform(text_, upper_, [](char c_) { return (char)toupper(c_); });
+
+	// the index ranges, the kernel does the loop
+	dbj::parallel::parallel_for(count_, [&](size_t begin_, size_t end_) { ... });
+
+anything with data() or begin(), and size(): DBJ_ARRAY, DBJ_ARRAY_WITH_PUSH,
+not_a_vector, std::vector, native arrays, dbj::parallel::span
+
+the grain, elements per task, is chosen automatically: about 4 chunks per
+worker, no less than DBJ_PARALLEL_MIN_GRAIN elements each. below that it
+all runs on the calling thread, no tasks. give the grain if you know better.
+
+all on dbj::tasks::default_pool() unless the pool is given. if the task can
+not be spawned its chunk runs on the calling thread, thus these do not
+fail. reduce() combines the chunks in order, thus for the given grain and
+the pool size the result is always the same, floating point too.
+*/
+
+#ifdef __clang__
+#pragma clang system_header
+#endif // __clang__
+
+#include "dbj_task_pool.h"
+
+#include <cassert>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#ifndef DBJ_PARALLEL_MIN_GRAIN
+#define DBJ_PARALLEL_MIN_GRAIN 2048
+#endif
+
+namespace dbj::parallel
+{
+	using dbj::tasks::default_pool;
+	using dbj::tasks::pool;
+
+	// pointer and size, nothing more
+	template <typename T>
+	struct span final
+	{
+		T* data_{};
+		std::size_t size_{};
+
+		T* data() const noexcept { return data_; }
+		std::size_t size() const noexcept { return size_; }
+		T* begin() const noexcept { return data_; }
+		T* end() const noexcept { return data_ + size_; }
+		T& operator[](std::size_t idx_) const noexcept
+		{
+			assert(idx_ < size_);
+			return data_[idx_];
+		}
+	};
+
+	namespace detail
+	{
+		template <typename C, typename = void>
+		struct has_data : std::false_type
+		{
+		};
+		template <typename C>
+		struct has_data<C, std::void_t<decltype(std::declval<C&>().data())>> : std::true_type
+		{
+		};
+	} // namespace detail
+
+	template <typename T>
+	inline span<T> as_span(T* data_, std::size_t size_) noexcept { return {data_, size_}; }
+
+	template <typename T, std::size_t N>
+	inline span<T> as_span(T (&native_)[N]) noexcept { return {native_, N}; }
+
+	template <typename T>
+	inline span<T> as_span(span<T> span_) noexcept { return span_; }
+
+	/*
+	data() if there is one, otherwise begin()
+	array_with_push has no data() and its end() is not the end of the data
+	thus always begin() and size()
+	*/
+	template <typename C>
+	inline auto as_span(C& container_) noexcept
+	{
+		if constexpr (detail::has_data<C>::value)
+		{
+			using T = std::remove_pointer_t<decltype(container_.data())>;
+			return span<T>{container_.data(), std::size_t(container_.size())};
+		}
+		else
+		{
+			using T = std::remove_reference_t<decltype(*container_.begin())>;
+			return span<T>{&*container_.begin(), std::size_t(container_.size())};
+		}
+	}
+
+	struct partition final
+	{
+		std::size_t grain{};
+		std::size_t chunks{};
+	};
+
+	// grain_ == 0 means automatic
+	inline partition make_partition(std::size_t count_, std::size_t grain_, pool const& pool_) noexcept
+	{
+		if (count_ == 0)
+			return {0, 0};
+		if (grain_ == 0)
+		{
+			const std::size_t workers_ = pool_.size() > 0 ? pool_.size() : 1;
+			grain_ = (count_ + 4 * workers_ - 1) / (4 * workers_);
+			if (grain_ < DBJ_PARALLEL_MIN_GRAIN)
+				grain_ = DBJ_PARALLEL_MIN_GRAIN;
+		}
+		return {grain_, (count_ + grain_ - 1) / grain_};
+	}
+
+	namespace detail
+	{
+		// on the worker, the spawns go to its own deque and wait() runs them
+		template <typename F>
+		inline void spawn_chunks(std::size_t count_, partition const& partition_, F& body_, pool& pool_) noexcept
+		{
+			dbj::tasks::task_group group_{pool_};
+			for (std::size_t chunk_ = 0; chunk_ < partition_.chunks; ++chunk_)
+			{
+				const std::size_t begin_ = chunk_ * partition_.grain;
+				const std::size_t end_ = (begin_ + partition_.grain < count_) ? begin_ + partition_.grain : count_;
+				auto [spawned_, status_] = group_.spawn([&body_, begin_, end_] { body_(begin_, end_); });
+				(void)status_;
+				if (!spawned_)
+					body_(begin_, end_);
+			}
+			(void)group_.wait();
+		}
+	} // namespace detail
+
+	/*
+	body_ is void (size_t begin, size_t end)
+	called for the consecutive index ranges covering [0, count_)
+	*/
+	template <typename F>
+	inline void parallel_for(std::size_t count_, F&& body_, std::size_t grain_ = 0, pool& pool_ = default_pool()) noexcept
+	{
+		const partition partition_ = make_partition(count_, grain_, pool_);
+		if (partition_.chunks < 2 || pool_.size() < 1)
+		{
+			if (count_ > 0)
+				body_(std::size_t(0), count_);
+			return;
+		}
+
+		if (pool_.is_worker())
+		{
+			detail::spawn_chunks(count_, partition_, body_, pool_);
+			return;
+		}
+
+		// DBJ NOTE: not on the worker, each chunk would go through the injection
+		// queue and its one lock, see dbj_task_pool.h. thus one root task, the
+		// chunks are spawned from inside the pool
+		dbj::tasks::task_group root_{pool_};
+		auto [spawned_, status_] = root_.spawn([&] { detail::spawn_chunks(count_, partition_, body_, pool_); });
+		(void)status_;
+		if (!spawned_)
+			detail::spawn_chunks(count_, partition_, body_, pool_);
+		(void)root_.wait();
+	}
+
+	/*
+	fun_ is void (T &)
+	*/
+	template <typename C, typename F>
+	inline void for_each(C&& container_, F&& fun_, std::size_t grain_ = 0, pool& pool_ = default_pool()) noexcept
+	{
+		auto span_ = as_span(container_);
+		parallel_for(
+			span_.size(), [&](std::size_t begin_, std::size_t end_) {
+				for (std::size_t idx_ = begin_; idx_ < end_; ++idx_)
+					fun_(span_.data()[idx_]);
+			},
+			grain_, pool_);
+	}
+
+	/*
+	accumulate_ is R (R, T const &), each chunk starts from the identity_
+	combine_ is R (R, R), the chunk results in order
+	*/
+	template <typename C, typename R, typename ACC, typename COMBINE,
+			  std::enable_if_t<std::is_invocable_r_v<R, COMBINE&, R, R>, int> = 0>
+	inline R reduce(C&& container_, R identity_, ACC&& accumulate_, COMBINE&& combine_,
+					std::size_t grain_ = 0, pool& pool_ = default_pool()) noexcept
+	{
+		auto span_ = as_span(container_);
+		const partition partition_ = make_partition(span_.size(), grain_, pool_);
+
+		auto chunk_ = [&](std::size_t begin_, std::size_t end_) {
+			R acc_ = identity_;
+			for (std::size_t idx_ = begin_; idx_ < end_; ++idx_)
+				acc_ = accumulate_(acc_, span_.data()[idx_]);
+			return acc_;
+		};
+
+		if (partition_.chunks < 2 || pool_.size() < 1)
+			return span_.size() > 0 ? chunk_(0, span_.size()) : identity_;
+
+		std::vector<R> partials_(partition_.chunks, identity_);
+		parallel_for(
+			span_.size(), [&](std::size_t begin_, std::size_t end_) {
+				partials_[begin_ / partition_.grain] = chunk_(begin_, end_);
+			},
+			partition_.grain, pool_);
+
+		R result_ = partials_[0];
+		for (std::size_t k = 1; k < partials_.size(); ++k)
+			result_ = combine_(result_, partials_[k]);
+		return result_;
+	}
+
+	// accumulate_ is also the combine
+	template <typename C, typename R, typename ACC>
+	inline R reduce(C&& container_, R identity_, ACC&& accumulate_,
+					std::size_t grain_ = 0, pool& pool_ = default_pool()) noexcept
+	{
+		return reduce(std::forward<C>(container_), identity_, accumulate_, accumulate_, grain_, pool_);
+	}
+
+	/*
+	fun_ is U (T const &), destination_[k] = fun_(source_[k])
+	destination_ must not be smaller, returns the number of elements done
+	*/
+	template <typename S, typename D, typename F>
+	inline std::size_t transform(S&& source_, D&& destination_, F&& fun_,
+								 std::size_t grain_ = 0, pool& pool_ = default_pool()) noexcept
+	{
+		auto from_ = as_span(source_);
+		auto to_ = as_span(destination_);
+		assert(to_.size() >= from_.size());
+		const std::size_t count_ = from_.size() < to_.size() ? from_.size() : to_.size();
+
+		parallel_for(
+			count_, [&](std::size_t begin_, std::size_t end_) {
+				for (std::size_t idx_ = begin_; idx_ < end_; ++idx_)
+					to_.data()[idx_] = fun_(from_.data()[idx_]);
+			},
+			grain_, pool_);
+		return count_;
+	}
+
+} // namespace dbj::parallel
+
+#ifdef DBJ_PARALLEL_TESTING
+/*
+the dbj containers through the parallel algorithms, and the checksum
+kernel timings, serial vs parallel
+
+	clang++ -std=c++17 -O2 -DDBJ_PARALLEL_TESTING -x c++ dbj_parallel.h
+*/
+#include <chrono>
+#include <cstdio>
+
+#include "nonstd/dbj++array.h"
+#include "nonstd/not_a_vector.h"
+
+namespace dbj::parallel::testing
+{
+	inline bool containers_test() noexcept
+	{
+		bool ok_ = true;
+
+		static DBJ_ARRAY<int, 0xFFF0> array_{};
+		for_each(array_, [](int& i_) { i_ = 1; });
+		ok_ &= (reduce(array_, 0L, [](long acc_, long v_) { return acc_ + v_; }) == 0xFFF0);
+
+		static DBJ_ARRAY_WITH_PUSH<int, 0x8000> pushed_{};
+		for (int k = 0; k < 0x7000; ++k)
+			(void)pushed_.push_back(k);
+		ok_ &= (reduce(pushed_, 0LL, [](long long acc_, long long v_) { return acc_ + v_; }) == 0x7000LL * 0x6FFF / 2);
+
+		not_a_vector<char> text_{};
+		for (int k = 0; k < 100000; ++k)
+			text_.push_back(char('a' + k % 26));
+		std::vector<char> upper_(text_.size());
+		ok_ &= (transform(text_, upper_, [](char c_) { return char(c_ - 'a' + 'A'); }) == text_.size());
+		ok_ &= (upper_[27] == 'B');
+
+		int native_[5000]{};
+		parallel_for(5000, [&](std::size_t b_, std::size_t e_) { for (; b_ < e_; ++b_) native_[b_] = int(b_); }, 100);
+		ok_ &= (reduce(native_, 0L, [](long acc_, long v_) { return acc_ + v_; }) == 5000L * 4999 / 2);
+
+		// the plain int grain is the grain, not the combine
+		ok_ &= (reduce(native_, 0L, [](long acc_, long v_) { return acc_ + v_; }, 256) == 5000L * 4999 / 2);
+		ok_ &= (reduce(
+					native_, 0L, [](long acc_, long v_) { return acc_ + v_; },
+					[](long l_, long r_) { return l_ + r_; }, 256) == 5000L * 4999 / 2);
+
+		// called from the worker, the chunks are spawned there
+		long nested_{};
+		dbj::tasks::task_group outer_{default_pool()};
+		(void)outer_.spawn([&] { nested_ = reduce(native_, 0L, [](long acc_, long v_) { return acc_ + v_; }, 100); });
+		(void)outer_.wait();
+		ok_ &= (nested_ == 5000L * 4999 / 2);
+
+		::printf("\ncontainers test: %s", ok_ ? "OK" : "FAILED");
+		return ok_;
+	}
+
+	// adler like, order does not matter thus it is reducible
+	inline bool checksum_benchmark() noexcept
+	{
+		std::vector<unsigned char> data_(std::size_t(1) << 26);
+		for_each(data_, [](unsigned char& c_) { c_ = (unsigned char)(reinterpret_cast<std::uintptr_t>(&c_) * 31); });
+
+		auto acc_ = [](std::uint64_t sum_, unsigned char c_) { return sum_ + c_ * 2654435761u; };
+		auto combine_ = [](std::uint64_t l_, std::uint64_t r_) { return l_ + r_; };
+
+		auto start_ = std::chrono::steady_clock::now();
+		std::uint64_t serial_{};
+		for (unsigned char c_ : data_)
+			serial_ = acc_(serial_, c_);
+		const double serial_ms_ = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_).count();
+
+		start_ = std::chrono::steady_clock::now();
+		const std::uint64_t parallel_ = reduce(data_, std::uint64_t{}, acc_, combine_);
+		const double parallel_ms_ = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_).count();
+
+		::printf("\nchecksum of %zu bytes, %zu workers  serial: %8.3f ms  parallel: %8.3f ms  speedup: %6.2f",
+				 data_.size(), default_pool().size(), serial_ms_, parallel_ms_, serial_ms_ / parallel_ms_);
+		return serial_ == parallel_;
+	}
+} // namespace dbj::parallel::testing
+
+int main()
+{
+	bool ok_ = dbj::parallel::testing::containers_test();
+	ok_ &= dbj::parallel::testing::checksum_benchmark();
+	::printf("\n%s\n", ok_ ? "OK" : "FAILED");
+	return ok_ ? 0 : 1;
+}
+#endif // DBJ_PARALLEL_TESTING
+
+#endif // DBJ_PARALLEL_INC
@@ -0,0 +1,329 @@
+#ifndef DBJ_SEQLOCK_INC
+#define DBJ_SEQLOCK_INC
+
+/*
+(c) 2021 by dbj.org   -- LICENSE DBJ -- https://dbj.org/license_dbj/
+
+dbj seqlock
+
+for the small, trivially copyable, read mostly structs: config, metrics
+and such. readers do not write to the shared memory at all, thus they
+do not bounce the cache line between them. they copy the value out and
+retry if the writer was in the middle of changing it.
+
+	struct config { int level; double ratio; char name[32]; };
+
+	dbj::seqlock<config> config_{};
+
+	// writer, never waits for the readers
+	config_.store( new_config_ );
+
+	// readers, no locks
+	config current_ = config_.load();
+
+the writer never blocks with one writer. several writers are allowed,
+they spin on each other, but the readers still do not take any lock.
+
+readers might retry forever if the writer writes all the time. seqlock
+is for the data which is read far more often than written.
+
+the value is kept in the relaxed atomic words, not as T. thus the torn
+copy the reader throws away is not the data race, and TSAN stays quiet.
+
+Note: this header does not depend on the rest of dbj, just on the
+dbj_nano_mutex.h
+*/
+
+#ifdef __clang__
+#pragma clang system_header
+#endif // __clang__
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include "dbj_nano_mutex.h"
+
+namespace dbj
+{
+	template <typename T>
+	class seqlock final
+	{
+		static_assert(std::is_trivially_copyable_v<T>, "seqlock<T> -- T must be trivially copyable");
+		static_assert(std::is_default_constructible_v<T>, "seqlock<T> -- T must be default constructible");
+
+		using word_type = std::uintptr_t;
+		static constexpr std::size_t word_count = (sizeof(T) + sizeof(word_type) - 1) / sizeof(word_type);
+
+		// even -- stable, odd -- writer is inside
+		alignas(DBJ_NANO_CACHE_LINE) std::atomic<std::uint64_t> sequence_{0};
+		std::atomic<word_type> words_[word_count]{};
+
+		void write_words(T const& value_) noexcept
+		{
+			word_type buffer_[word_count]{};
+			std::memcpy(buffer_, &value_, sizeof(T));
+			for (std::size_t k = 0; k < word_count; ++k)
+				words_[k].store(buffer_[k], std::memory_order_relaxed);
+		}
+
+		T read_words() const noexcept
+		{
+			word_type buffer_[word_count];
+			for (std::size_t k = 0; k < word_count; ++k)
+				buffer_[k] = words_[k].load(std::memory_order_relaxed);
+			T value_{};
+			std::memcpy(&value_, buffer_, sizeof(T));
+			return value_;
+		}
+
+		// returns the odd sequence
+		std::uint64_t write_begin() noexcept
+		{
+			std::uint64_t seq_ = sequence_.load(std::memory_order_relaxed);
+			for (;;)
+			{
+				// the other writer is inside
+				if (seq_ & 1)
+				{
+					DBJ_CPU_RELAX();
+					seq_ = sequence_.load(std::memory_order_relaxed);
+					continue;
+				}
+				if (sequence_.compare_exchange_weak(seq_, seq_ + 1,
+													std::memory_order_acquire, std::memory_order_relaxed))
+					break;
+			}
+			// the data stores can not move above the odd sequence
+			std::atomic_thread_fence(std::memory_order_release);
+			return seq_ + 1;
+		}
+
+		void write_end(std::uint64_t odd_seq_) noexcept
+		{
+			sequence_.store(odd_seq_ + 1, std::memory_order_release);
+		}
+
+	public:
+		using value_type = T;
+
+		seqlock() noexcept { write_words(T{}); }
+		explicit seqlock(T const& value_) noexcept { write_words(value_); }
+
+		seqlock(seqlock const&) = delete;
+		seqlock& operator=(seqlock const&) = delete;
+
+		void store(T const& value_) noexcept
+		{
+			const std::uint64_t seq_ = write_begin();
+			write_words(value_);
+			write_end(seq_);
+		}
+
+		/*
+		read, modify, write, as one
+		fun_ is void (T &)
+		*/
+		template <typename F>
+		void update(F&& fun_) noexcept
+		{
+			const std::uint64_t seq_ = write_begin();
+			T value_ = read_words();
+			fun_(value_);
+			write_words(value_);
+			write_end(seq_);
+		}
+
+		/*
+		one attempt, false if the writer was inside
+		for the readers which have something better to do than to retry
+		*/
+		bool try_load(T& out_) const noexcept
+		{
+			const std::uint64_t before_ = sequence_.load(std::memory_order_acquire);
+			if (before_ & 1)
+				return false;
+			T value_ = read_words();
+			// the data loads can not move bellow the second sequence load
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (before_ != sequence_.load(std::memory_order_relaxed))
+				return false;
+			out_ = value_;
+			return true;
+		}
+
+		// retries until the consistent copy is made
+		T load() const noexcept
+		{
+			T value_{};
+			while (!try_load(value_))
+				DBJ_CPU_RELAX();
+			return value_;
+		}
+
+		// even number, changes on each store
+		// equal versions means equal values
+		std::uint64_t version() const noexcept
+		{
+			return sequence_.load(std::memory_order_acquire) & ~std::uint64_t(1);
+		}
+	}; // seqlock
+
+} // namespace dbj
+
+#ifdef DBJ_SEQLOCK_TESTING
+/*
+stress test and the benchmark against the global_lock_unlock
+requires dbj_common.h and the rest
+
+	clang++ -std=c++17 -O2 -DDBJ_SEQLOCK_TESTING -x c++ dbj_seqlock.h
+*/
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "dbj_nano_synchro.h"
+
+namespace dbj::seqlock_testing
+{
+	// all the fields are always equal, torn read is the one where they are not
+	struct sample final
+	{
+		std::uint64_t fields[8];
+	};
+
+	inline sample make_sample(std::uint64_t value_) noexcept
+	{
+		sample retval_{};
+		for (auto& field_ : retval_.fields)
+			field_ = value_;
+		return retval_;
+	}
+
+	inline bool is_torn(sample const& sample_) noexcept
+	{
+		for (auto field_ : sample_.fields)
+			if (field_ != sample_.fields[0])
+				return true;
+		return false;
+	}
+
+	// returns the number of torn reads, must be 0
+	inline std::uint64_t torn_reads_test(unsigned readers_ = 4, std::uint64_t writes_ = 100000)
+	{
+		seqlock<sample> shared_{make_sample(0)};
+		std::atomic<bool> done_{false};
+		std::atomic<std::uint64_t> torn_{0};
+		std::atomic<std::uint64_t> reads_{0};
+
+		std::vector<std::thread> threads_;
+		for (unsigned k = 0; k < readers_; ++k)
+			threads_.emplace_back([&] {
+				std::uint64_t last_{0}, count_{0};
+				while (!done_.load(std::memory_order_relaxed))
+				{
+					const sample current_ = shared_.load();
+					if (is_torn(current_) || current_.fields[0] < last_)
+						torn_.fetch_add(1, std::memory_order_relaxed);
+					last_ = current_.fields[0];
+					++count_;
+				}
+				reads_.fetch_add(count_, std::memory_order_relaxed);
+			});
+
+		for (std::uint64_t value_ = 1; value_ <= writes_; ++value_)
+		{
+			shared_.store(make_sample(value_));
+			if (0 == (value_ % 64))
+				std::this_thread::yield();
+		}
+		done_ = true;
+		for (auto& thread_ : threads_)
+			thread_.join();
+
+		if (is_torn(shared_.load()) || shared_.load().fields[0] != writes_)
+			torn_.fetch_add(1);
+
+		::printf("\nseqlock torn reads test: %llu reads, %llu writes, %llu torn",
+				 (unsigned long long)reads_.load(), (unsigned long long)writes_,
+				 (unsigned long long)torn_.load());
+		return torn_.load();
+	}
+
+	/*
+	readers_ threads read, one thread writes every now and then
+	prints the reads per microsecond for both
+	*/
+	inline void benchmark(unsigned readers_ = std::thread::hardware_concurrency(),
+						  std::chrono::milliseconds duration_ = std::chrono::milliseconds(500))
+	{
+		if (readers_ < 1)
+			readers_ = 1;
+
+		auto run_ = [&](const char* title_, auto reader_, auto writer_) {
+			std::atomic<bool> done_{false};
+			std::atomic<std::uint64_t> reads_{0};
+			// so that the reads are not optimized away
+			std::atomic<std::uint64_t> sink_{0};
+			std::vector<std::thread> threads_;
+			for (unsigned k = 0; k < readers_; ++k)
+				threads_.emplace_back([&] {
+					std::uint64_t count_{0}, checksum_{0};
+					while (!done_.load(std::memory_order_relaxed))
+					{
+						checksum_ += reader_().fields[3];
+						++count_;
+					}
+					reads_.fetch_add(count_, std::memory_order_relaxed);
+					sink_.fetch_add(checksum_, std::memory_order_relaxed);
+				});
+
+			const auto start_ = std::chrono::steady_clock::now();
+			std::uint64_t value_{0};
+			while (std::chrono::steady_clock::now() - start_ < duration_)
+			{
+				writer_(make_sample(++value_));
+				std::this_thread::sleep_for(std::chrono::microseconds(100));
+			}
+			done_ = true;
+			for (auto& thread_ : threads_)
+				thread_.join();
+
+			const double us_ = double(std::chrono::duration_cast<std::chrono::microseconds>(
+										  std::chrono::steady_clock::now() - start_)
+										  .count());
+			::printf("\n%-24s readers: %3u  reads/us: %10.3f  writes: %llu",
+					 title_, readers_, reads_.load() / us_, (unsigned long long)value_);
+		};
+
+		seqlock<sample> seq_{};
+		run_(
+			"seqlock", [&] { return seq_.load(); }, [&](sample const& s_) { seq_.store(s_); });
+
+		sample guarded_{};
+		run_(
+			"global_lock_unlock",
+			[&] {
+				::dbj::global_lock_unlock lock_;
+				return guarded_;
+			},
+			[&](sample const& s_) {
+				::dbj::global_lock_unlock lock_;
+				guarded_ = s_;
+			});
+		::printf("\n");
+	}
+} // namespace dbj::seqlock_testing
+
+int main()
+{
+	const std::uint64_t torn_ = dbj::seqlock_testing::torn_reads_test();
+	dbj::seqlock_testing::benchmark();
+	return torn_ == 0 ? 0 : 1;
+}
+#endif // DBJ_SEQLOCK_TESTING
+
+#endif // DBJ_SEQLOCK_INC
@@ -0,0 +1,222 @@
+#ifndef DBJ_SHARDED_COUNTER_INC
+#define DBJ_SHARDED_COUNTER_INC
+
+/*
+(c) 2021 by dbj.org   -- LICENSE DBJ -- https://dbj.org/license_dbj/
+
+dbj sharded counter
+
+for the hot statistics: hits, misses, bytes sent and such. counted from
+many threads, read once in a while.
+
+one std::atomic counted from all the threads is one cache line bouncing
+between all the cores, on each increment. global_lock_unlock around the
+plain counter is the same line plus the lock. sharded_counter gives each
+thread its own cache padded slot, increments touch no shared line.
+
+	dbj::sharded_counter<> hits_;
+
+	// on each thread
+	hits_ += 1;
+	++hits_;
+
+	// on the reporting thread, sums the shards
+	auto total_ = hits_.load();
+
+thread is mapped to its shard by dbj::alloc::this_thread_index(). more
+threads than shards is fine, they share, but then they share the line too.
+the default is one shard per hardware thread.
+
+load() is not the snapshot. it is the sum of the shards as they are
+while it walks them, thus it might miss the concurrent increments. it
+never sees the increment partially.
+
+Note: this header does not depend on the rest of dbj, just on the
+nonstd/cache_padded.h
+*/
+
+#ifdef __clang__
+#pragma clang system_header
+#endif // __clang__
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <type_traits>
+
+#include "nonstd/cache_padded.h"
+
+namespace dbj
+{
+	template <typename T = std::uint64_t>
+	class sharded_counter final
+	{
+		static_assert(std::is_integral_v<T>, "sharded_counter<T> -- T must be integral");
+
+		// relaxed, the counter is statistics not the synchronization
+		dbj::alloc::per_thread_array<std::atomic<T>> shards_;
+
+	public:
+		using value_type = T;
+
+		explicit sharded_counter(std::size_t shards_count_ = std::thread::hardware_concurrency())
+			: shards_(shards_count_)
+		{
+		}
+
+		sharded_counter(sharded_counter const&) = delete;
+		sharded_counter& operator=(sharded_counter const&) = delete;
+
+		std::size_t shards() const noexcept { return shards_.size(); }
+
+		void add(T value_) noexcept
+		{
+			shards_.local().fetch_add(value_, std::memory_order_relaxed);
+		}
+
+		sharded_counter& operator+=(T value_) noexcept
+		{
+			add(value_);
+			return *this;
+		}
+
+		sharded_counter& operator-=(T value_) noexcept
+		{
+			add(T(0) - value_);
+			return *this;
+		}
+
+		// DBJ NOTE: no post increment, that would need the sum
+		sharded_counter& operator++() noexcept
+		{
+			add(T(1));
+			return *this;
+		}
+
+		sharded_counter& operator--() noexcept
+		{
+			add(T(0) - T(1));
+			return *this;
+		}
+
+		T load() const noexcept { return shards_.sum(); }
+
+		operator T() const noexcept { return load(); }
+
+		/*
+		returns the sum and zeroes the shards
+		each increment is counted exactly once, by this or by the next
+		*/
+		T exchange_zero() noexcept
+		{
+			T sum_{};
+			for (std::size_t k = 0; k < shards_.size(); ++k)
+				sum_ = T(sum_ + shards_[k].exchange(T(0), std::memory_order_relaxed));
+			return sum_;
+		}
+
+		void reset() noexcept { (void)exchange_zero(); }
+	}; // sharded_counter
+
+} // namespace dbj
+
+#ifdef DBJ_SHARDED_COUNTER_TESTING
+/*
+increments per second by the number of threads, for one atomic,
+the counter under global_lock_unlock and the sharded counter
+requires dbj_common.h and the rest
+
+	clang++ -std=c++17 -O2 -DDBJ_SHARDED_COUNTER_TESTING -x c++ dbj_sharded_counter.h
+	a.out [max threads]
+*/
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "dbj_nano_synchro.h"
+
+namespace dbj::sharded_counter_testing
+{
+	/*
+	each thread does iterations_ increments
+	prints million increments per second
+	returns false if the total is wrong
+	*/
+	template <typename INC, typename TOTAL>
+	inline bool run(const char* title_, unsigned threads_, unsigned iterations_, INC increment_, TOTAL total_)
+	{
+		std::atomic<bool> go_{false};
+		std::vector<std::thread> workers_;
+
+		for (unsigned t_ = 0; t_ < threads_; ++t_)
+			workers_.emplace_back([&] {
+				while (!go_.load(std::memory_order_acquire))
+					std::this_thread::yield();
+				for (unsigned k = 0; k < iterations_; ++k)
+					increment_();
+			});
+
+		const auto start_ = std::chrono::steady_clock::now();
+		go_.store(true, std::memory_order_release);
+		for (auto& worker_ : workers_)
+			worker_.join();
+		const double seconds_ = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count();
+
+		const std::uint64_t expected_ = std::uint64_t(threads_) * iterations_;
+		const std::uint64_t counted_ = total_();
+		::printf("\n%-20s threads: %3u  Mops/s: %10.3f  %s",
+				 title_, threads_, double(expected_) / seconds_ / 1e6,
+				 counted_ == expected_ ? "" : "WRONG TOTAL");
+		return counted_ == expected_;
+	}
+
+	inline bool scaling(unsigned max_threads_, unsigned iterations_ = 1000000)
+	{
+		bool ok_ = true;
+		for (unsigned threads_ = 1; threads_ <= max_threads_; threads_ *= 2)
+		{
+			{
+				std::atomic<std::uint64_t> counter_{0};
+				ok_ &= run(
+					"std::atomic", threads_, iterations_,
+					[&] { counter_.fetch_add(1, std::memory_order_relaxed); },
+					[&] { return counter_.load(); });
+			}
+			{
+				std::uint64_t counter_{0};
+				ok_ &= run(
+					"global_lock_unlock", threads_, iterations_ / 10,
+					[&] {
+						::dbj::global_lock_unlock lock_;
+						++counter_;
+					},
+					[&] { return counter_; });
+			}
+			{
+				// consecutive thread indices, each thread is alone on its shard
+				sharded_counter<> counter_(2 * max_threads_);
+				ok_ &= run(
+					"sharded_counter", threads_, iterations_,
+					[&] { ++counter_; },
+					[&] { return counter_.load(); });
+			}
+			::printf("\n");
+		}
+		return ok_;
+	}
+} // namespace dbj::sharded_counter_testing
+
+int main(int argc, char** argv)
+{
+	unsigned max_threads_ = 2 * std::thread::hardware_concurrency();
+	if (argc > 1)
+		max_threads_ = unsigned(atoi(argv[1]));
+	if (max_threads_ < 1)
+		max_threads_ = 1;
+	return dbj::sharded_counter_testing::scaling(max_threads_) ? 0 : 1;
+}
+#endif // DBJ_SHARDED_COUNTER_TESTING
+
+#endif // DBJ_SHARDED_COUNTER_INC
@@ -0,0 +1,801 @@
+#ifndef DBJ_TASK_POOL_INC
+#define DBJ_TASK_POOL_INC
+
+/*
+(c) 2021 by dbj.org   -- LICENSE DBJ -- https://dbj.org/license_dbj/
+
+dbj work stealing task pool
+
+each worker has its own Chase-Lev deque. it pushes and pops its own tasks
+at the bottom, no locks, no sharing. idle workers steal from the top of
+the others deques. threads which are not the workers of the pool put
+the tasks on the small locked injection queue.
+
+	dbj::tasks::task_group group_ ; // on the default_pool()
+
+	auto [ok_, status_] = group_.spawn([&] { left_ = work(0, half_); });
+	if (!ok_) ... status_ says why ...
+
+	(void) group_.spawn([&] { right_ = work(half_, size_); });
+
+	auto [done_, wait_status_] = group_.wait();
+
+on the worker, wait() does not just wait, it runs the tasks from the pool
+while the group is not done. thus the tasks can spawn and wait for the
+nested groups, fork/join style, without blocking the workers. the other
+threads spin for a while then sleep in wait(). they do not help, tasks
+they would run would spawn through the injection queue, which is slow.
+thus for the fine grained work spawn the root task and wait for it.
+
+no exceptions. spawn() and wait() return dbj::light::valstat<task_group>
+
+	{ &group, nullptr }  -- OK
+	{ nullptr, status }  -- error, status is the message, never free it
+
+the tasks report the errors through task_group::report( status ), the
+first one reported is the status wait() returns.
+
+the task callable is kept inside the task block, DBJ_TASK_CAPTURE bytes at
+most, thus capture by reference, or capture pointers. blocks are cached
+per thread, after the warm up spawn() does not touch the heap.
+*/
+
+#ifdef __clang__
+#pragma clang system_header
+#endif // __clang__
+
+#include "dbj_valstat.h"
+#include "dbj_heap_alloc.h"
+#include "dbj_nano_mutex.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// bytes available for the task callable
+#ifndef DBJ_TASK_CAPTURE
+#define DBJ_TASK_CAPTURE 112
+#endif
+
+// starting capacity of the worker deque, it grows
+#ifndef DBJ_TASK_DEQUE_CAPACITY
+#define DBJ_TASK_DEQUE_CAPACITY 256
+#endif
+
+// task blocks kept per thread, for the reuse
+#ifndef DBJ_TASK_CACHE
+#define DBJ_TASK_CACHE 256
+#endif
+
+namespace dbj::tasks
+{
+	class task_group;
+	class pool;
+
+	/*
+	the task block, the callable lives inside
+	*/
+	struct task final
+	{
+		union
+		{
+			void (*invoke)(task*);
+			task* next_free;
+		};
+		task_group* group;
+		alignas(std::max_align_t) unsigned char storage[DBJ_TASK_CAPTURE];
+
+		/*
+		per thread cache of the free blocks
+		block freed on another thread goes to that thread cache
+		*/
+		struct cache final
+		{
+			task* head{};
+			std::size_t count{};
+
+			~cache()
+			{
+				while (head)
+				{
+					task* next_ = head->next_free;
+					DBJ_FREE(head);
+					head = next_;
+				}
+			}
+		};
+
+		static cache& local_cache() noexcept
+		{
+			thread_local cache cache_{};
+			return cache_;
+		}
+
+		// nullptr on no memory
+		static task* make() noexcept
+		{
+			cache& cache_ = local_cache();
+			if (cache_.head)
+			{
+				task* block_ = cache_.head;
+				cache_.head = block_->next_free;
+				cache_.count -= 1;
+				return block_;
+			}
+			return static_cast<task*>(DBJ_MALLOC(sizeof(task)));
+		}
+
+		static void recycle(task* block_) noexcept
+		{
+			cache& cache_ = local_cache();
+			if (cache_.count >= DBJ_TASK_CACHE)
+			{
+				DBJ_FREE(block_);
+				return;
+			}
+			block_->next_free = cache_.head;
+			cache_.head = block_;
+			cache_.count += 1;
+		}
+	}; // task
+
+	/*
+	Chase-Lev work stealing deque
+
+	"Dynamic Circular Work-Stealing Deque", Chase and Lev, 2005
+	memory orders from "Correct and Efficient Work-Stealing for Weak
+	Memory Models", Le, Pop, Cohen, Zappa Nardelli, 2013
+
+	push() and pop() by the owner only, steal() by anybody
+	the old rings are kept until the deque is gone, the thieves might
+	still be reading them
+	*/
+	class work_deque final
+	{
+		struct ring final
+		{
+			std::int64_t capacity{};
+			std::atomic<task*>* slots{};
+			ring* retired{};
+
+			std::atomic<task*>& at(std::int64_t index_) const noexcept
+			{
+				return slots[index_ & (capacity - 1)];
+			}
+		};
+
+		alignas(DBJ_NANO_CACHE_LINE) std::atomic<std::int64_t> top_{0};
+		alignas(DBJ_NANO_CACHE_LINE) std::atomic<std::int64_t> bottom_{0};
+		std::atomic<ring*> ring_{nullptr};
+
+		static ring* make_ring(std::int64_t capacity_) noexcept
+		{
+			ring* ring_ = static_cast<ring*>(DBJ_MALLOC(sizeof(ring)));
+			if (!ring_)
+				return nullptr;
+			void* slots_ = DBJ_MALLOC(sizeof(std::atomic<task*>) * std::size_t(capacity_));
+			if (!slots_)
+			{
+				DBJ_FREE(ring_);
+				return nullptr;
+			}
+			new (ring_) ring{capacity_, static_cast<std::atomic<task*>*>(slots_), nullptr};
+			for (std::int64_t k = 0; k < capacity_; ++k)
+				new (&ring_->slots[k]) std::atomic<task*>(nullptr);
+			return ring_;
+		}
+
+		static void free_ring(ring* ring_) noexcept
+		{
+			DBJ_FREE(ring_->slots);
+			DBJ_FREE(ring_);
+		}
+
+	public:
+		work_deque() noexcept
+		{
+			ring_.store(make_ring(DBJ_TASK_DEQUE_CAPACITY), std::memory_order_relaxed);
+		}
+
+		~work_deque()
+		{
+			ring* walker_ = ring_.load(std::memory_order_relaxed);
+			while (walker_)
+			{
+				ring* retired_ = walker_->retired;
+				free_ring(walker_);
+				walker_ = retired_;
+			}
+		}
+
+		work_deque(work_deque const&) = delete;
+		work_deque& operator=(work_deque const&) = delete;
+
+		bool valid() const noexcept { return ring_.load(std::memory_order_relaxed) != nullptr; }
+
+		// racy, for the hints only
+		bool looks_empty() const noexcept
+		{
+			return bottom_.load(std::memory_order_relaxed) <= top_.load(std::memory_order_relaxed);
+		}
+
+		// owner only, false if it could not grow
+		bool push(task* task_) noexcept
+		{
+			const std::int64_t bottom_now_ = bottom_.load(std::memory_order_relaxed);
+			const std::int64_t top_now_ = top_.load(std::memory_order_acquire);
+			ring* ring_now_ = ring_.load(std::memory_order_relaxed);
+
+			if (bottom_now_ - top_now_ > ring_now_->capacity - 1)
+			{
+				ring* bigger_ = make_ring(ring_now_->capacity * 2);
+				if (!bigger_)
+					return false;
+				for (std::int64_t k = top_now_; k < bottom_now_; ++k)
+					bigger_->at(k).store(ring_now_->at(k).load(std::memory_order_relaxed), std::memory_order_relaxed);
+				bigger_->retired = ring_now_;
+				ring_.store(bigger_, std::memory_order_release);
+				ring_now_ = bigger_;
+			}
+			ring_now_->at(bottom_now_).store(task_, std::memory_order_relaxed);
+			// release, not the fence, so that TSAN sees it too
+			bottom_.store(bottom_now_ + 1, std::memory_order_release);
+			return true;
+		}
+
+		// owner only, nullptr if empty
+		task* pop() noexcept
+		{
+			const std::int64_t bottom_now_ = bottom_.load(std::memory_order_relaxed) - 1;
+			ring* ring_now_ = ring_.load(std::memory_order_relaxed);
+			bottom_.store(bottom_now_, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			std::int64_t top_now_ = top_.load(std::memory_order_relaxed);
+
+			if (top_now_ > bottom_now_)
+			{
+				// was empty
+				bottom_.store(bottom_now_ + 1, std::memory_order_relaxed);
+				return nullptr;
+			}
+
+			task* task_ = ring_now_->at(bottom_now_).load(std::memory_order_relaxed);
+			if (top_now_ == bottom_now_)
+			{
+				// the last one, race with the thieves
+				if (!top_.compare_exchange_strong(top_now_, top_now_ + 1,
+												  std::memory_order_seq_cst, std::memory_order_relaxed))
+					task_ = nullptr;
+				bottom_.store(bottom_now_ + 1, std::memory_order_relaxed);
+			}
+			return task_;
+		}
+
+		// anybody, nullptr if empty or lost the race
+		task* steal() noexcept
+		{
+			std::int64_t top_now_ = top_.load(std::memory_order_acquire);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			const std::int64_t bottom_now_ = bottom_.load(std::memory_order_acquire);
+
+			if (top_now_ >= bottom_now_)
+				return nullptr;
+
+			ring* ring_now_ = ring_.load(std::memory_order_acquire);
+			task* task_ = ring_now_->at(top_now_).load(std::memory_order_relaxed);
+			if (!top_.compare_exchange_strong(top_now_, top_now_ + 1,
+											  std::memory_order_seq_cst, std::memory_order_relaxed))
+				return nullptr;
+			return task_;
+		}
+	}; // work_deque
+
+	/*
+	the workers and their deques
+	*/
+	class pool final
+	{
+		struct alignas(2 * DBJ_NANO_CACHE_LINE) worker final
+		{
+			work_deque deque{};
+			std::thread thread{};
+			std::uint32_t random{};
+		};
+
+		std::vector<worker*> workers_{};
+
+		// from the threads which are not our workers
+		nano::mutex injected_lock_{};
+		std::vector<task*> injected_{};
+		std::atomic<std::size_t> injected_count_{0};
+
+		// parking of the idle workers
+		alignas(DBJ_NANO_CACHE_LINE) std::atomic<std::uint32_t> epoch_{0};
+		std::atomic<std::uint32_t> sleepers_{0};
+		std::atomic<bool> stopping_{false};
+
+		struct identity final
+		{
+			pool* owner{};
+			worker* self{};
+		};
+
+		static identity& this_thread() noexcept
+		{
+			thread_local identity identity_{};
+			return identity_;
+		}
+
+		worker* my_worker() const noexcept
+		{
+			identity const& id_ = this_thread();
+			return id_.owner == this ? id_.self : nullptr;
+		}
+
+		bool push_injected(task* task_) noexcept
+		{
+			nano::mutex& lock_ = injected_lock_;
+			lock_.lock();
+			injected_.push_back(task_);
+			injected_count_.fetch_add(1, std::memory_order_release);
+			lock_.unlock();
+			return true;
+		}
+
+		task* take_injected() noexcept
+		{
+			if (injected_count_.load(std::memory_order_acquire) == 0)
+				return nullptr;
+			task* task_ = nullptr;
+			injected_lock_.lock();
+			if (!injected_.empty())
+			{
+				task_ = injected_.back();
+				injected_.pop_back();
+				injected_count_.fetch_sub(1, std::memory_order_relaxed);
+			}
+			injected_lock_.unlock();
+			return task_;
+		}
+
+		// xorshift, per worker, no sharing
+		static std::uint32_t next_random(std::uint32_t& state_) noexcept
+		{
+			state_ ^= state_ << 13;
+			state_ ^= state_ >> 17;
+			state_ ^= state_ << 5;
+			return state_;
+		}
+
+		task* steal_from_others(worker* self_) noexcept
+		{
+			const std::size_t count_ = workers_.size();
+			std::uint32_t seed_ = self_ ? next_random(self_->random)
+										: std::uint32_t(nano::this_thread_index() * 2654435761u + 1);
+			const std::size_t start_ = seed_ % count_;
+			for (std::size_t k = 0; k < count_; ++k)
+			{
+				worker* victim_ = workers_[(start_ + k) % count_];
+				if (victim_ == self_)
+					continue;
+				if (task* task_ = victim_->deque.steal())
+					return task_;
+			}
+			return nullptr;
+		}
+
+		task* find_work(worker* self_) noexcept
+		{
+			if (self_)
+				if (task* task_ = self_->deque.pop())
+					return task_;
+			if (task* task_ = take_injected())
+				return task_;
+			return steal_from_others(self_);
+		}
+
+		bool work_visible() const noexcept
+		{
+			if (injected_count_.load() > 0)
+				return true;
+			for (worker* worker_ : workers_)
+				if (!worker_->deque.looks_empty())
+					return true;
+			return false;
+		}
+
+		void notify() noexcept
+		{
+			// the pushed task must be visible before the sleepers are looked at
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if (sleepers_.load() > 0)
+			{
+				epoch_.fetch_add(1);
+				nano::futex_wake_one(&epoch_);
+			}
+		}
+
+		void park() noexcept
+		{
+			sleepers_.fetch_add(1);
+			// pairs with the fence in notify(), Dekker style: either notify()
+			// sees this sleeper, or the deques are looked at after the push
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			const std::uint32_t epoch_seen_ = epoch_.load();
+			if (!stopping_.load() && !work_visible())
+				nano::futex_wait(&epoch_, epoch_seen_);
+			sleepers_.fetch_sub(1);
+		}
+
+		void worker_loop(worker* self_) noexcept
+		{
+			this_thread() = identity{this, self_};
+			unsigned idle_{0};
+			for (;;)
+			{
+				if (task* task_ = find_work(self_))
+				{
+					execute(task_);
+					idle_ = 0;
+					continue;
+				}
+				if (stopping_.load(std::memory_order_acquire) && !work_visible())
+					break;
+				if (++idle_ < DBJ_NANO_MAX_SPIN)
+					DBJ_CPU_RELAX();
+				else if (idle_ < 2 * DBJ_NANO_MAX_SPIN)
+					std::this_thread::yield();
+				else
+				{
+					park();
+					idle_ = 0;
+				}
+			}
+			this_thread() = identity{};
+		}
+
+		static void execute(task* task_) noexcept;
+
+		friend class task_group;
+
+	public:
+		// 0 means std::thread::hardware_concurrency()
+		explicit pool(unsigned threads_ = 0) noexcept
+		{
+			if (threads_ == 0)
+				threads_ = std::thread::hardware_concurrency();
+			if (threads_ == 0)
+				threads_ = 1;
+
+			workers_.reserve(threads_);
+			for (unsigned k = 0; k < threads_; ++k)
+			{
+				worker* worker_ = new (std::nothrow) worker{};
+				if (!worker_ || !worker_->deque.valid())
+				{
+					delete worker_;
+					break;
+				}
+				worker_->random = 2654435761u * (k + 1);
+				workers_.push_back(worker_);
+			}
+			// start them only once the vector is complete
+			for (worker* worker_ : workers_)
+				worker_->thread = std::thread([this, worker_] { worker_loop(worker_); });
+		}
+
+		// runs what is left, then stops
+		~pool()
+		{
+			stopping_.store(true, std::memory_order_release);
+			epoch_.fetch_add(1);
+			nano::futex_wake_all(&epoch_);
+			for (worker* worker_ : workers_)
+				worker_->thread.join();
+			// only now, the others might be stealing from it till the end
+			for (worker* worker_ : workers_)
+				delete worker_;
+		}
+
+		pool(pool const&) = delete;
+		pool& operator=(pool const&) = delete;
+
+		// 0 if no worker could be made
+		std::size_t size() const noexcept { return workers_.size(); }
+
+		// is the calling thread one of ours
+		bool is_worker() const noexcept { return my_worker() != nullptr; }
+
+	private:
+		// the status message or nullptr on success
+		const char* submit(task* task_) noexcept
+		{
+			if (workers_.empty())
+				return "dbj::tasks::pool -- no workers";
+			if (stopping_.load(std::memory_order_relaxed))
+				return "dbj::tasks::pool -- pool is stopping";
+
+			if (worker* self_ = my_worker())
+			{
+				if (!self_->deque.push(task_))
+					return "dbj::tasks::pool -- out of memory, the deque can not grow";
+			}
+			else
+			{
+				push_injected(task_);
+			}
+			notify();
+			return nullptr;
+		}
+	}; // pool
+
+	/*
+	process wide pool, made on the first call
+	*/
+	inline pool& default_pool() noexcept
+	{
+		static pool pool_{};
+		return pool_;
+	}
+
+	/*
+	the tasks spawned, and what they have reported
+	must not go out of scope before wait(), the destructor waits
+	*/
+	class task_group final
+	{
+		// in pending_, set by wait() before it sleeps
+		static constexpr std::uint32_t sleeping_bit = 1u << 31;
+
+		pool& pool_;
+		alignas(DBJ_NANO_CACHE_LINE) std::atomic<std::uint32_t> pending_{0};
+		std::atomic<const char*> status_{nullptr};
+
+		void finished() noexcept
+		{
+			// DBJ NOTE: as soon as the count is 0 wait() might return and
+			// this group be gone, thus no reading of the members after.
+			// waking up the stale address is harmless.
+			std::atomic<std::uint32_t>* pending_address_ = &pending_;
+			if (pending_.fetch_sub(1, std::memory_order_acq_rel) == (sleeping_bit | 1))
+				nano::futex_wake_all(pending_address_);
+		}
+
+		friend class pool;
+
+	public:
+		using valstat_type = dbj::light::valstat<task_group>;
+
+		explicit task_group(pool& pool_arg_ = default_pool()) noexcept : pool_(pool_arg_) {}
+
+		~task_group() { (void)wait(); }
+
+		task_group(task_group const&) = delete;
+		task_group& operator=(task_group const&) = delete;
+
+		pool& get_pool() const noexcept { return pool_; }
+
+		/*
+		F is void ()
+		*/
+		template <typename F>
+		[[nodiscard]] valstat_type spawn(F&& fun_) noexcept
+		{
+			using fun_type = std::decay_t<F>;
+			static_assert(sizeof(fun_type) <= DBJ_TASK_CAPTURE,
+						  "task_group::spawn() -- callable too big, capture by reference or increase DBJ_TASK_CAPTURE");
+			static_assert(alignof(fun_type) <= alignof(std::max_align_t),
+						  "task_group::spawn() -- callable is over aligned");
+			static_assert(std::is_invocable_v<fun_type&>, "task_group::spawn() -- callable must be void ()");
+
+			task* task_ = task::make();
+			if (!task_)
+				return {nullptr, "dbj::tasks::task_group -- out of memory"};
+
+			new (task_->storage) fun_type(std::forward<F>(fun_));
+			task_->invoke = [](task* self_) {
+				fun_type* callable_ = std::launder(reinterpret_cast<fun_type*>(self_->storage));
+				(*callable_)();
+				callable_->~fun_type();
+			};
+			task_->group = this;
+
+			pending_.fetch_add(1, std::memory_order_relaxed);
+			if (const char* status_ = pool_.submit(task_))
+			{
+				reinterpret_cast<fun_type*>(task_->storage)->~fun_type();
+				task::recycle(task_);
+				pending_.fetch_sub(1, std::memory_order_relaxed);
+				return {nullptr, status_};
+			}
+			return {this, nullptr};
+		}
+
+		/*
+		on the worker runs the pool tasks until all of this group are done
+		returns the first status reported, if any
+		*/
+		[[nodiscard]] valstat_type wait() noexcept
+		{
+			pool::worker* self_ = pool_.my_worker();
+			unsigned idle_{0};
+			std::uint32_t pending_now_{};
+			while (((pending_now_ = pending_.load(std::memory_order_acquire)) & ~sleeping_bit) != 0)
+			{
+				if (self_)
+					if (task* task_ = pool_.find_work(self_))
+					{
+						pool::execute(task_);
+						idle_ = 0;
+						continue;
+					}
+				if (++idle_ < DBJ_NANO_MAX_SPIN)
+					DBJ_CPU_RELAX();
+				else if (self_ || idle_ < 2 * DBJ_NANO_MAX_SPIN)
+					// the worker never parks here, the tasks it waits
+					// for might be in its own deque
+					std::this_thread::yield();
+				else if (pending_now_ & sleeping_bit ||
+						 pending_.compare_exchange_weak(pending_now_, pending_now_ | sleeping_bit))
+					nano::futex_wait(&pending_, pending_now_ | sleeping_bit);
+			}
+			// all done, nobody else is here
+			if (pending_now_ & sleeping_bit)
+				pending_.fetch_and(~sleeping_bit, std::memory_order_relaxed);
+
+			if (const char* reported_ = status_.load(std::memory_order_acquire))
+				return {nullptr, reported_};
+			return {this, nullptr};
+		}
+
+		// from the task, the first one reported is kept
+		void report(const char* status_arg_) noexcept
+		{
+			const char* expected_ = nullptr;
+			status_.compare_exchange_strong(expected_, status_arg_, std::memory_order_acq_rel);
+		}
+
+		// racy, for the diagnostics
+		std::uint32_t pending() const noexcept { return pending_.load(std::memory_order_relaxed) & ~sleeping_bit; }
+	}; // task_group
+
+	inline void pool::execute(task* task_) noexcept
+	{
+		task_group* group_ = task_->group;
+		task_->invoke(task_);
+		task::recycle(task_);
+		group_->finished();
+	}
+
+} // namespace dbj::tasks
+
+#ifdef DBJ_TASK_POOL_TESTING
+/*
+fork/join benchmarks
+
+	clang++ -std=c++17 -O2 -DDBJ_TASK_POOL_TESTING -x c++ dbj_task_pool.h
+	a.out [threads]
+*/
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+namespace dbj::tasks::testing
+{
+	inline double seconds_since(std::chrono::steady_clock::time_point start_) noexcept
+	{
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count();
+	}
+
+	inline std::uint64_t fib_serial(unsigned n_) noexcept
+	{
+		return n_ < 2 ? n_ : fib_serial(n_ - 1) + fib_serial(n_ - 2);
+	}
+
+	// the classic, very fine grained, thus measures the overhead
+	inline std::uint64_t fib_tasks(pool& pool_, unsigned n_, unsigned cutoff_) noexcept
+	{
+		if (n_ < cutoff_)
+			return fib_serial(n_);
+		std::uint64_t left_{}, right_{};
+		task_group group_{pool_};
+		(void)group_.spawn([&] { left_ = fib_tasks(pool_, n_ - 1, cutoff_); });
+		right_ = fib_tasks(pool_, n_ - 2, cutoff_);
+		(void)group_.wait();
+		return left_ + right_;
+	}
+
+	// recursive halving, the usual divide and conquer shape
+	inline double sum_tasks(pool& pool_, const double* data_, std::size_t size_, std::size_t grain_) noexcept
+	{
+		if (size_ <= grain_)
+		{
+			double sum_{};
+			for (std::size_t k = 0; k < size_; ++k)
+				sum_ += data_[k];
+			return sum_;
+		}
+		const std::size_t half_ = size_ / 2;
+		double left_{}, right_{};
+		task_group group_{pool_};
+		(void)group_.spawn([&] { left_ = sum_tasks(pool_, data_, half_, grain_); });
+		right_ = sum_tasks(pool_, data_ + half_, size_ - half_, grain_);
+		(void)group_.wait();
+		return left_ + right_;
+	}
+
+	// the root task in the pool, so that the spawns go to the worker deques
+	template <typename F>
+	inline void run_in(pool& pool_, F&& fun_) noexcept
+	{
+		task_group root_{pool_};
+		(void)root_.spawn(fun_);
+		(void)root_.wait();
+	}
+
+	inline bool status_test(pool& pool_) noexcept
+	{
+		task_group group_{pool_};
+		for (int k = 0; k < 8; ++k)
+			(void)group_.spawn([&group_, k] { if (k == 5) group_.report("task 5 failed"); });
+		auto [ok_, status_] = group_.wait();
+		::printf("\nstatus test: %s", status_ ? status_ : "no status");
+		return ok_ == nullptr && status_ != nullptr;
+	}
+
+	inline int benchmark(unsigned threads_) noexcept
+	{
+		pool pool_{threads_};
+		::printf("\ndbj task pool, %zu workers", pool_.size());
+		bool ok_ = status_test(pool_);
+
+		for (unsigned cutoff_ : {2u, 10u, 20u})
+		{
+			const unsigned n_ = 30;
+			auto start_ = std::chrono::steady_clock::now();
+			const std::uint64_t expected_ = fib_serial(n_);
+			const double serial_ = seconds_since(start_);
+
+			start_ = std::chrono::steady_clock::now();
+			std::uint64_t result_{};
+			run_in(pool_, [&] { result_ = fib_tasks(pool_, n_, cutoff_); });
+			const double parallel_ = seconds_since(start_);
+
+			ok_ &= (result_ == expected_);
+			::printf("\nfib(%u) cutoff %2u  serial: %8.3f ms  tasks: %8.3f ms  speedup: %6.2f",
+					 n_, cutoff_, serial_ * 1e3, parallel_ * 1e3, serial_ / parallel_);
+		}
+
+		std::vector<double> data_(1 << 24, 1.0);
+		for (std::size_t grain_ : {std::size_t(1) << 12, std::size_t(1) << 16})
+		{
+			auto start_ = std::chrono::steady_clock::now();
+			const double expected_ = sum_tasks(pool_, data_.data(), data_.size(), data_.size());
+			const double serial_ = seconds_since(start_);
+
+			start_ = std::chrono::steady_clock::now();
+			double result_{};
+			run_in(pool_, [&] { result_ = sum_tasks(pool_, data_.data(), data_.size(), grain_); });
+			const double parallel_ = seconds_since(start_);
+
+			ok_ &= (result_ == expected_);
+			::printf("\nsum of %zu grain %6zu  serial: %8.3f ms  tasks: %8.3f ms  speedup: %6.2f",
+					 data_.size(), grain_, serial_ * 1e3, parallel_ * 1e3, serial_ / parallel_);
+		}
+		::printf("\n%s\n", ok_ ? "OK" : "FAILED");
+		return ok_ ? 0 : 1;
+	}
+} // namespace dbj::tasks::testing
+
+int main(int argc, char** argv)
+{
+	return dbj::tasks::testing::benchmark(argc > 1 ? unsigned(atoi(argv[1])) : 0u);
+}
+#endif // DBJ_TASK_POOL_TESTING
+
+#endif // DBJ_TASK_POOL_INC
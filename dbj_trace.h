@@ -0,0 +1,525 @@
+#ifndef DBJ_TRACE_INC
+#define DBJ_TRACE_INC
+
+/*
+(c) 2021 by dbj.org   -- LICENSE DBJ -- https://dbj.org/license_dbj/
+
+dbj trace zones, to the Chrome trace event JSON
+
+open the file in chrome://tracing or https://ui.perfetto.dev
+
+opt in, define DBJ_TRACE before including this. Without it the zone
+macro is empty and the functions are empty inlines, nothing is left
+in the instrumented code.
+
+	int main () {
+		// flushing every 100 ms on the background thread, 0 is no thread
+		dbj::trace::open("trace.json", 100);
+		...
+	}
+
+	void parse ( ... ) {
+		DBJ_TRACE_ZONE("parse");
+		...
+		{
+			DBJ_TRACE_ZONE("parse header");
+			...
+		}
+	}
+
+	// the file is closed at exit, or
+	dbj::trace::close();
+
+zone names must be string literals, or live as long as the process.
+they are not copied, just the pointers are kept until the flush.
+
+each thread writes its zones into its own ring, two time stamps and the
+name pointer, no locks, no allocation after the first zone. flush()
+drains the rings to the file, from any thread, at any time. when the
+ring is not drained in time the oldest zones are lost, and counted.
+DBJ_TRACE_RING_SIZE is the ring capacity, in zones.
+
+rings of the threads which are gone are reused by the new threads.
+
+time stamps are from stopwatch::tsc::now_ticks(), see nonstd/dbj_timer.h
+*/
+
+#ifdef __clang__
+#pragma clang system_header
+#endif // __clang__
+
+#ifdef DBJ_TRACE
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <thread>
+
+#include "dbj_nano_mutex.h"
+#include "nonstd/dbj_timer.h"
+
+#ifdef _WIN32
+#include <process.h>
+#define DBJ_TRACE_GETPID _getpid
+#else
+#include <unistd.h>
+#define DBJ_TRACE_GETPID getpid
+#endif
+
+// zones per thread, must be the power of two
+#ifndef DBJ_TRACE_RING_SIZE
+#define DBJ_TRACE_RING_SIZE (1 << 14)
+#endif
+
+namespace dbj::trace
+{
+	static_assert((DBJ_TRACE_RING_SIZE & (DBJ_TRACE_RING_SIZE - 1)) == 0,
+				  "DBJ_TRACE_RING_SIZE must be the power of two");
+
+	/*
+	one complete zone
+	relaxed atomics, since the flush might read the slot which is being
+	overwritten, that copy is detected and thrown away
+	*/
+	struct event final
+	{
+		std::atomic<const char*> name{nullptr};
+		std::atomic<std::uint64_t> begin{0};
+		std::atomic<std::uint64_t> end{0};
+		std::atomic<std::uint32_t> tid{0};
+	};
+
+	struct ring final
+	{
+		static constexpr std::uint64_t capacity = DBJ_TRACE_RING_SIZE;
+		static constexpr std::uint64_t mask = capacity - 1;
+
+		// written by the owner only
+		alignas(DBJ_NANO_CACHE_LINE) std::atomic<std::uint64_t> head{0};
+		// the owner thread index
+		std::uint32_t tid{};
+
+		// the flush only, under the flush lock
+		alignas(DBJ_NANO_CACHE_LINE) std::uint64_t flushed{0};
+
+		std::atomic<bool> owned{false};
+		ring* next{};
+
+		event events[capacity]{};
+
+		void push(const char* name_, std::uint64_t begin_, std::uint64_t end_) noexcept
+		{
+			const std::uint64_t idx_ = head.load(std::memory_order_relaxed);
+			event& slot_ = events[idx_ & mask];
+			// as the seqlock writer, the slot stores can not move above this point
+			// the reader who sees one of them sees the head up to idx_ after its fence
+			std::atomic_thread_fence(std::memory_order_release);
+			slot_.name.store(name_, std::memory_order_relaxed);
+			slot_.begin.store(begin_, std::memory_order_relaxed);
+			slot_.end.store(end_, std::memory_order_relaxed);
+			slot_.tid.store(tid, std::memory_order_relaxed);
+			head.store(idx_ + 1, std::memory_order_release);
+		}
+	};
+
+	struct state_type final
+	{
+		std::atomic<bool> is_open{false};
+		std::atomic<ring*> rings{nullptr};
+
+		// the rest under the lock
+		nano::mutex lock;
+		FILE* file{};
+		bool first_event{true};
+		bool exit_registered{false};
+		std::uint64_t origin{};
+		std::uint64_t dropped{};
+
+		// the background flush
+		std::thread flusher;
+		std::atomic<std::uint32_t> stop{0};
+	};
+
+	inline state_type& state() noexcept
+	{
+		static state_type state_{};
+		return state_;
+	}
+
+	namespace detail
+	{
+		// takes the free ring or makes the new one, nullptr if out of memory
+		inline ring* acquire_ring() noexcept
+		{
+			state_type& state_ = state();
+			for (ring* walker_ = state_.rings.load(std::memory_order_acquire); walker_; walker_ = walker_->next)
+			{
+				bool expected_ = false;
+				if (walker_->owned.compare_exchange_strong(expected_, true, std::memory_order_acquire))
+					return walker_;
+			}
+			ring* new_ = new (std::nothrow) ring{};
+			if (!new_)
+				return nullptr;
+			new_->owned.store(true, std::memory_order_relaxed);
+			new_->next = state_.rings.load(std::memory_order_relaxed);
+			while (!state_.rings.compare_exchange_weak(new_->next, new_, std::memory_order_release, std::memory_order_relaxed))
+			{
+			}
+			return new_;
+		}
+
+		// gives the ring back when the thread is gone
+		struct ring_holder final
+		{
+			ring* ring_{};
+
+			ring_holder() noexcept : ring_(acquire_ring())
+			{
+				if (ring_)
+					ring_->tid = std::uint32_t(nano::this_thread_index());
+			}
+
+			~ring_holder()
+			{
+				if (ring_)
+					ring_->owned.store(false, std::memory_order_release);
+			}
+
+			ring_holder(ring_holder const&) = delete;
+			ring_holder& operator=(ring_holder const&) = delete;
+		};
+
+		inline ring* local_ring() noexcept
+		{
+			thread_local ring_holder holder_{};
+			return holder_.ring_;
+		}
+
+		// names with the quote or the backslash are rare, thus the slow path
+		inline void write_name(FILE* file_, const char* name_) noexcept
+		{
+			if (!std::strpbrk(name_, "\"\\"))
+			{
+				std::fputs(name_, file_);
+				return;
+			}
+			for (; *name_; ++name_)
+			{
+				if (*name_ == '"' || *name_ == '\\')
+					std::fputc('\\', file_);
+				std::fputc(*name_, file_);
+			}
+		}
+
+		// under the lock
+		inline void write_event(state_type& state_, const char* name_, std::uint64_t begin_,
+								std::uint64_t end_, std::uint32_t tid_, int pid_) noexcept
+		{
+			const double us_per_tick_ = stopwatch::tsc::calibrated().ns_per_tick / 1000.0;
+			const double ts_ = begin_ > state_.origin ? double(begin_ - state_.origin) * us_per_tick_ : 0.0;
+			const double dur_ = end_ > begin_ ? double(end_ - begin_) * us_per_tick_ : 0.0;
+
+			std::fputs(state_.first_event ? "\n{\"name\":\"" : ",\n{\"name\":\"", state_.file);
+			write_name(state_.file, name_);
+			std::fprintf(state_.file, "\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%u}",
+						 ts_, dur_, pid_, tid_);
+			state_.first_event = false;
+		}
+
+		// under the lock
+		inline void drain(state_type& state_, ring& ring_) noexcept
+		{
+			constexpr std::uint64_t batch_size_ = 256;
+			struct copy_type
+			{
+				const char* name;
+				std::uint64_t begin, end;
+				std::uint32_t tid;
+			} batch_[batch_size_];
+
+			const int pid_ = int(DBJ_TRACE_GETPID());
+			const std::uint64_t head_ = ring_.head.load(std::memory_order_acquire);
+
+			while (ring_.flushed < head_)
+			{
+				// the owner went around, those are lost
+				if (head_ - ring_.flushed > ring::capacity)
+				{
+					state_.dropped += head_ - ring_.flushed - ring::capacity;
+					ring_.flushed = head_ - ring::capacity;
+				}
+
+				const std::uint64_t from_ = ring_.flushed;
+				const std::uint64_t to_ = (head_ - from_ > batch_size_) ? from_ + batch_size_ : head_;
+				for (std::uint64_t k = from_; k < to_; ++k)
+				{
+					event const& slot_ = ring_.events[k & ring::mask];
+					copy_type& copy_ = batch_[k - from_];
+					copy_.name = slot_.name.load(std::memory_order_relaxed);
+					copy_.begin = slot_.begin.load(std::memory_order_relaxed);
+					copy_.end = slot_.end.load(std::memory_order_relaxed);
+					copy_.tid = slot_.tid.load(std::memory_order_relaxed);
+				}
+
+				// the copies can not move bellow the head load
+				// the ones the owner might have started overwriting are not valid
+				std::atomic_thread_fence(std::memory_order_acquire);
+				const std::uint64_t head_now_ = ring_.head.load(std::memory_order_relaxed);
+				const std::uint64_t valid_from_ = head_now_ > ring::capacity ? head_now_ - ring::capacity + 1 : 0;
+
+				for (std::uint64_t k = from_; k < to_; ++k)
+				{
+					if (k < valid_from_)
+					{
+						++state_.dropped;
+						continue;
+					}
+					copy_type const& copy_ = batch_[k - from_];
+					if (copy_.name)
+						write_event(state_, copy_.name, copy_.begin, copy_.end, copy_.tid, pid_);
+				}
+				ring_.flushed = to_;
+			}
+		}
+
+		inline void flush_locked(state_type& state_) noexcept
+		{
+			if (!state_.file)
+				return;
+			for (ring* walker_ = state_.rings.load(std::memory_order_acquire); walker_; walker_ = walker_->next)
+				drain(state_, *walker_);
+			std::fflush(state_.file);
+		}
+	} // namespace detail
+
+	inline bool is_open() noexcept
+	{
+		return state().is_open.load(std::memory_order_relaxed);
+	}
+
+	// writes all the zones recorded so far
+	inline void flush() noexcept
+	{
+		state_type& state_ = state();
+		state_.lock.lock();
+		detail::flush_locked(state_);
+		state_.lock.unlock();
+	}
+
+	// zones lost since open(), the rings were not drained in time
+	inline std::uint64_t dropped() noexcept
+	{
+		state_type& state_ = state();
+		state_.lock.lock();
+		const std::uint64_t dropped_ = state_.dropped;
+		state_.lock.unlock();
+		return dropped_;
+	}
+
+	// flush and close, called at exit if not before
+	inline void close() noexcept
+	{
+		state_type& state_ = state();
+
+		if (state_.flusher.joinable())
+		{
+			state_.stop.store(1, std::memory_order_release);
+			nano::futex_wake_all(&state_.stop);
+			state_.flusher.join();
+		}
+
+		state_.lock.lock();
+		if (state_.file)
+		{
+			state_.is_open.store(false, std::memory_order_relaxed);
+			detail::flush_locked(state_);
+			std::fprintf(state_.file, "\n],\n\"displayTimeUnit\":\"ns\"\n}\n");
+			std::fclose(state_.file);
+			state_.file = nullptr;
+		}
+		state_.lock.unlock();
+	}
+
+	/*
+	returns false if the file could not be opened, or is open already
+	flush_every_ms_ > 0 starts the background flush thread
+	*/
+	inline bool open(const char* path_, unsigned flush_every_ms_ = 0) noexcept
+	{
+		state_type& state_ = state();
+		state_.lock.lock();
+		if (state_.file)
+		{
+			state_.lock.unlock();
+			return false;
+		}
+		state_.file = std::fopen(path_, "w");
+		if (!state_.file)
+		{
+			state_.lock.unlock();
+			std::perror(" (" __FILE__ ") dbj::trace::open()");
+			return false;
+		}
+		std::fprintf(state_.file, "{\n\"traceEvents\":[");
+		state_.first_event = true;
+		state_.dropped = 0;
+		state_.origin = stopwatch::tsc::now_ticks();
+
+		// the zones from before are not wanted
+		for (ring* walker_ = state_.rings.load(std::memory_order_acquire); walker_; walker_ = walker_->next)
+			walker_->flushed = walker_->head.load(std::memory_order_acquire);
+
+		if (!state_.exit_registered)
+		{
+			state_.exit_registered = true;
+			std::atexit([] { close(); });
+		}
+		state_.is_open.store(true, std::memory_order_relaxed);
+		state_.lock.unlock();
+
+		if (flush_every_ms_ > 0)
+		{
+			state_.stop.store(0, std::memory_order_relaxed);
+			state_.flusher = std::thread([flush_every_ms_] {
+				state_type& state_ = state();
+				const std::chrono::nanoseconds period_ = std::chrono::milliseconds(flush_every_ms_);
+				while (state_.stop.load(std::memory_order_acquire) == 0)
+				{
+					nano::futex_wait_for(&state_.stop, 0, period_);
+					flush();
+				}
+			});
+		}
+		return true;
+	}
+
+	/*
+	the scope, DBJ_TRACE_ZONE makes one
+	nothing is recorded while the file is not open
+	*/
+	class zone final
+	{
+		const char* name_{};
+		std::uint64_t begin_{};
+
+	public:
+		explicit zone(const char* name_arg_) noexcept
+		{
+			if (!is_open())
+				return;
+			name_ = name_arg_;
+			begin_ = stopwatch::tsc::now_ticks();
+		}
+
+		~zone()
+		{
+			if (!name_)
+				return;
+			const std::uint64_t end_ = stopwatch::tsc::now_ticks();
+			if (ring* ring_ = detail::local_ring())
+				ring_->push(name_, begin_, end_);
+		}
+
+		zone(zone const&) = delete;
+		zone& operator=(zone const&) = delete;
+	};
+
+} // namespace dbj::trace
+
+#define DBJ_TRACE_CONCAT_IMPL_(A_, B_) A_##B_
+#define DBJ_TRACE_CONCAT_(A_, B_) DBJ_TRACE_CONCAT_IMPL_(A_, B_)
+#define DBJ_TRACE_ZONE(NAME_) ::dbj::trace::zone DBJ_TRACE_CONCAT_(dbj_trace_zone_, __LINE__){NAME_}
+
+#else // ! DBJ_TRACE
+
+#include <cstdint>
+
+// nothing to see here
+namespace dbj::trace
+{
+	inline bool is_open() noexcept { return false; }
+	inline bool open(const char*, unsigned = 0) noexcept { return false; }
+	inline void flush() noexcept {}
+	inline void close() noexcept {}
+	inline std::uint64_t dropped() noexcept { return 0; }
+} // namespace dbj::trace
+
+#define DBJ_TRACE_ZONE(NAME_)
+
+#endif // ! DBJ_TRACE
+
+#ifdef DBJ_TRACE_TESTING
+/*
+nested zones on a few threads, to the trace.json, and the zone cost
+
+	clang++ -std=c++17 -O2 -DDBJ_TRACE -DDBJ_TRACE_TESTING -x c++ dbj_trace.h
+
+without DBJ_TRACE it shows the zone cost, when there is no zone
+*/
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "nonstd/dbj_timer.h"
+
+namespace dbj::trace::testing
+{
+	inline unsigned fib(unsigned n_)
+	{
+		DBJ_TRACE_ZONE("fib");
+		return n_ < 2 ? n_ : fib(n_ - 1) + fib(n_ - 2);
+	}
+
+	inline void worker(unsigned id_)
+	{
+		DBJ_TRACE_ZONE("worker");
+		for (unsigned k = 0; k < 20; ++k)
+		{
+			DBJ_TRACE_ZONE("step");
+			volatile unsigned sink_ = fib(8 + id_ % 4);
+			(void)sink_;
+			std::this_thread::sleep_for(std::chrono::microseconds(200));
+		}
+	}
+
+	// nanoseconds per zone
+	inline double zone_cost(unsigned count_ = 1000) noexcept
+	{
+		const std::uint64_t start_ = stopwatch::tsc::steady_ns();
+		for (unsigned k = 0; k < count_; ++k)
+		{
+			DBJ_TRACE_ZONE("cost");
+		}
+		return double(stopwatch::tsc::steady_ns() - start_) / count_;
+	}
+} // namespace dbj::trace::testing
+
+int main()
+{
+#ifdef DBJ_TRACE
+	if (!dbj::trace::open("trace.json", 50))
+		return 1;
+#endif
+
+	std::vector<std::thread> threads_;
+	for (unsigned t_ = 0; t_ < 4; ++t_)
+		threads_.emplace_back(dbj::trace::testing::worker, t_);
+	for (auto& thread_ : threads_)
+		thread_.join();
+
+	const double cost_ = dbj::trace::testing::zone_cost();
+	::printf("\n%.3f ns per zone, %llu dropped, see trace.json\n",
+			 cost_, (unsigned long long)dbj::trace::dropped());
+	dbj::trace::close();
+	return 0;
+}
+#endif // DBJ_TRACE_TESTING
+
+#endif // DBJ_TRACE_INC
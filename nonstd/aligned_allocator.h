@@ -3,11 +3,15 @@
 #ifdef __clang__
 #pragma clang system_header
 #endif // __clang__
-// #ifdef _WIN32
+#ifdef _WIN32
 #include <malloc.h>
-// #endif
+#else
+#include <stdlib.h>
+#endif
+#include <cstddef>
 #include <cstdint>
-// #include <vector>
+#include <cstdio>
+#include <vector>
 
 #ifndef DBJ_CPLUSPLUS
 #if defined(_MSVC_LANG) && !defined(__clang__)
@@ -27,8 +31,55 @@
 perror( " (" __FILE__ ") " MSG_ ); \
 exit(EXIT_FAILURE);
 
+// override if your target is different
+// 64 is right for x64 and most of ARM64
+#ifndef DBJ_CACHE_LINE_SIZE
+#define DBJ_CACHE_LINE_SIZE 64
+#endif
+
+#ifndef DBJ_PAGE_SIZE
+#define DBJ_PAGE_SIZE 4096
+#endif
+
 namespace dbj::alloc
 {
+	constexpr inline std::size_t cache_line_size = DBJ_CACHE_LINE_SIZE;
+	constexpr inline std::size_t page_size = DBJ_PAGE_SIZE;
+
+	/*
+	aligned heap backend
+
+	_mm_malloc is used where it exists, thus no change there.
+	On MSVC it is the macro from malloc.h, mapped to _aligned_malloc.
+	Everywhere else it is posix_memalign, it is in every libc worth using.
+	*/
+	inline void* aligned_malloc(std::size_t size_, std::size_t alignment_) noexcept
+	{
+#if defined(_mm_malloc)
+		return _mm_malloc(size_, alignment_);
+#elif defined(_WIN32)
+		return _aligned_malloc(size_, alignment_);
+#else
+		// posix_memalign requires multiple of sizeof(void*)
+		if (alignment_ < sizeof(void*))
+			alignment_ = sizeof(void*);
+		void* pv_ = NULL;
+		if (0 != posix_memalign(&pv_, alignment_, size_))
+			return NULL;
+		return pv_;
+#endif
+	}
+
+	inline void aligned_free(void* pv_) noexcept
+	{
+#if defined(_mm_free)
+		_mm_free(pv_);
+#elif defined(_WIN32)
+		_aligned_free(pv_);
+#else
+		free(pv_);
+#endif
+	}
 
 	/**
 	 * Allocator for aligned data.
@@ -42,6 +93,8 @@ namespace dbj::alloc
 		// DBJ -- G++ will not work if not inheriting from 
 		// : std::allocator<T>
 	{
+		static_assert(Alignment > 0 && (Alignment & (Alignment - 1)) == 0,
+			"aligned_allocator -- Alignment must be the power of 2");
 	public:
 
 #if 1 // not inheriting from std::alloc
@@ -52,7 +105,7 @@ namespace dbj::alloc
 		typedef const T& const_reference;
 		typedef T value_type;
 		typedef std::size_t size_type;
-		typedef ptrdiff_t difference_type;
+		typedef std::ptrdiff_t difference_type;
 #endif // not inheriting from std::alloc
 
 		// this is not part of standard allocator requirements
@@ -104,11 +157,7 @@ namespace dbj::alloc
 				DBJ_ALLIGNED_ALLOCATOR_FAIL_POLICY("aligned_allocator<T>::allocate() - Integer overflow.");
 			}
 
-			// should be defined universaly, across C and C++ compilers/libs
-#ifndef _mm_malloc
-#error  _mm_malloc undefined?
-#endif
-			void* const pv = _mm_malloc(n * sizeof(T), Alignment);
+			void* const pv = aligned_malloc(n * sizeof(T), Alignment);
 
 			// Allocators should throw std::bad_alloc in the case of memory allocation failure.
 			// alas DBJDBJ does not throw, so he will just calmly exit the app
@@ -120,15 +169,18 @@ namespace dbj::alloc
 			return static_cast<T*>(pv);
 		}
 
-		void deallocate(T* const p, const std::size_t n) const
+		void deallocate(T* const p, const std::size_t /*n*/) const
 		{
-			// should be defined universaly, across C and C++ compilers/libs
-#ifndef _mm_free
-#error  _mm_free undefined?
-#endif
-			_mm_free(p);
+			aligned_free(p);
 		}
 
+		// stateless, thus all are equal
+		template <typename U>
+		bool operator==(const aligned_allocator<U, Alignment>&) const noexcept { return true; }
+
+		template <typename U>
+		bool operator!=(const aligned_allocator<U, Alignment>&) const noexcept { return false; }
+
 
 	private:
 		// Allocators are not required to be assignable, so
@@ -143,6 +195,17 @@ namespace dbj::alloc
 
 	}; // aligned_allocator
 
+	/*
+	SIMD friendly buffers
+
+	cache_aligned_vector<float> kernel_input_(1024);
+	*/
+	template <typename T>
+	using cache_aligned_vector = std::vector<T, aligned_allocator<T, cache_line_size>>;
+
+	template <typename T>
+	using page_aligned_vector = std::vector<T, aligned_allocator<T, page_size>>;
+
 } // namespace dbj::alloc 
 
 #undef DBJ_ALLIGNED_ALLOCATOR_FAIL_POLICY
@@ -0,0 +1,350 @@
+#ifndef DBJ_ARENA_ALLOCATOR_INC_
+#define DBJ_ARENA_ALLOCATOR_INC_
+#ifdef __clang__
+#pragma clang system_header
+#endif // __clang__
+
+/*
+ (c) 2021 by dbj.org   -- LICENSE DBJ -- https://dbj.org/license_dbj/
+
+ monotonic arena
+
+ memory is handed out by bumping a pointer through a chain of blocks.
+ nothing is ever freed one by one. reset() rewinds to the first block
+ in O(1), and keeps the blocks for the next round. release() gives the
+ blocks back to the heap.
+
+ the use case is request scoped work: parse, format, convert, then
+ forget everything in one go
+
+	using namespace dbj::alloc;
+
+	arena request_arena_{};
+
+	{
+		arena_vector<char> text_( arena_allocator<char>(request_arena_) );
+		text_.resize(1024);
+		// ...
+	}
+	request_arena_.reset();
+
+ NOTE: destructors of objects placed in the arena are never called
+ by the arena. put trivially destructible things in here, or call them
+ yourself.
+
+ NOTE: arena is not thread safe. one arena per thread or per request.
+*/
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <new>
+#include <vector>
+
+#include "../dbj_heap_alloc.h"
+
+#undef DBJ_ARENA_FAIL_POLICY
+// redefine this to return instead of exit() if required
+#define DBJ_ARENA_FAIL_POLICY( MSG_) \
+perror( " (" __FILE__ ") " MSG_ ); \
+exit(EXIT_FAILURE);
+
+namespace dbj::alloc
+{
+	class arena final
+	{
+		// block header is followed by the block data
+		struct block_header
+		{
+			block_header* next;
+			std::size_t capacity;
+		};
+
+		static char* block_data(block_header* block_) noexcept
+		{
+			return reinterpret_cast<char*>(block_ + 1);
+		}
+
+		static char* align_up(char* ptr_, std::size_t alignment_) noexcept
+		{
+			const std::uintptr_t mask_ = alignment_ - 1;
+			return reinterpret_cast<char*>(
+				(reinterpret_cast<std::uintptr_t>(ptr_) + mask_) & ~mask_);
+		}
+
+		block_header* head_{};
+		block_header* current_{};
+		char* cursor_{};
+		char* limit_{};
+		std::size_t block_size_{};
+		std::size_t bytes_used_{};
+
+		void enter(block_header* block_) noexcept
+		{
+			current_ = block_;
+			cursor_ = block_data(block_);
+			limit_ = cursor_ + block_->capacity;
+		}
+
+		void* bump(std::size_t bytes_, std::size_t alignment_) noexcept
+		{
+			char* ptr_ = align_up(cursor_, alignment_);
+			if (ptr_ > limit_ || static_cast<std::size_t>(limit_ - ptr_) < bytes_)
+				return nullptr;
+			cursor_ = ptr_ + bytes_;
+			bytes_used_ += bytes_;
+			return ptr_;
+		}
+
+		void* allocate_slow(std::size_t bytes_, std::size_t alignment_) noexcept
+		{
+			// first reuse the blocks kept after the last reset()
+			// the ones too small for this request are skipped, they are
+			// used again after the next reset()
+			block_header* walker_ = current_ ? current_->next : head_;
+			while (walker_)
+			{
+				enter(walker_);
+				if (void* ptr_ = bump(bytes_, alignment_); ptr_)
+					return ptr_;
+				walker_ = walker_->next;
+			}
+
+			// the chain is exhausted, add the new block at the end
+			// oversized requests get the block of their own size
+			// DBJ NOTE: bytes_ + alignment_ + header must not wrap around
+			if (bytes_ > (std::size_t(-1) - sizeof(block_header) - alignment_))
+			{
+				DBJ_ARENA_FAIL_POLICY("arena::allocate() - Integer overflow.");
+			}
+
+			std::size_t capacity_ = bytes_ + alignment_;
+			if (capacity_ < block_size_)
+				capacity_ = block_size_;
+
+			if (capacity_ > (std::size_t(-1) - sizeof(block_header)))
+			{
+				DBJ_ARENA_FAIL_POLICY("arena::allocate() - Integer overflow.");
+			}
+
+			void* mem_ = DBJ_MALLOC(sizeof(block_header) + capacity_);
+			if (mem_ == nullptr)
+			{
+				DBJ_ARENA_FAIL_POLICY("arena::allocate() - memory allocation failure");
+			}
+
+			block_header* block_ = static_cast<block_header*>(mem_);
+			block_->next = nullptr;
+			block_->capacity = capacity_;
+
+			if (current_)
+				current_->next = block_;
+			else
+				head_ = block_;
+
+			enter(block_);
+			return bump(bytes_, alignment_);
+		}
+
+	public:
+		// 64KB blocks by default
+		constexpr static std::size_t default_block_size = 0xFFFF + 1;
+
+		explicit arena(std::size_t block_size_arg_ = default_block_size) noexcept
+			: block_size_(block_size_arg_ > 0 ? block_size_arg_ : default_block_size)
+		{
+		}
+
+		~arena() noexcept { release(); }
+
+		arena(arena const&) = delete;
+		arena& operator=(arena const&) = delete;
+		arena(arena&&) = delete;
+		arena& operator=(arena&&) = delete;
+
+		// alignment has to be the power of 2
+		void* allocate(std::size_t bytes_, std::size_t alignment_ = alignof(std::max_align_t)) noexcept
+		{
+			assert(alignment_ > 0 && ((alignment_ & (alignment_ - 1)) == 0));
+
+			if (bytes_ == 0)
+				bytes_ = 1;
+
+			if (current_)
+				if (void* ptr_ = bump(bytes_, alignment_); ptr_)
+					return ptr_;
+
+			return allocate_slow(bytes_, alignment_);
+		}
+
+		// construct T in the arena
+		// its destructor will not be called by the arena
+		template <typename T, typename... Args>
+		T* create(Args&&... args_) noexcept
+		{
+			return ::new (allocate(sizeof(T), alignof(T))) T(static_cast<Args&&>(args_)...);
+		}
+
+		// O(1) -- everything allocated is forgotten
+		// the blocks are kept for the next round
+		void reset() noexcept
+		{
+			bytes_used_ = 0;
+			if (head_)
+				enter(head_);
+		}
+
+		// give all the blocks back to the heap
+		void release() noexcept
+		{
+			block_header* walker_ = head_;
+			while (walker_)
+			{
+				block_header* next_ = walker_->next;
+				DBJ_FREE(walker_);
+				walker_ = next_;
+			}
+			head_ = current_ = nullptr;
+			cursor_ = limit_ = nullptr;
+			bytes_used_ = 0;
+		}
+
+		// bytes handed out since the last reset, padding excluded
+		std::size_t bytes_used() const noexcept { return bytes_used_; }
+
+		// sum of all the blocks capacities
+		std::size_t capacity() const noexcept
+		{
+			std::size_t total_{};
+			for (block_header* walker_ = head_; walker_; walker_ = walker_->next)
+				total_ += walker_->capacity;
+			return total_;
+		}
+
+		std::size_t block_size() const noexcept { return block_size_; }
+
+	}; // arena
+
+	/*
+	STL allocator adapter over the arena
+
+	deallocate() does nothing, memory goes back with arena::reset()
+	two arena_allocators are equal if they use the same arena
+	*/
+	template <typename T>
+	struct arena_allocator
+	{
+		using value_type = T;
+		using size_type = std::size_t;
+		using difference_type = std::ptrdiff_t;
+
+		template <typename U>
+		struct rebind
+		{
+			typedef arena_allocator<U> other;
+		};
+
+		arena* arena_{};
+
+		// arena_allocator can not be default constructed
+		// it has to know the arena
+		explicit arena_allocator(arena& arena_arg_) noexcept : arena_(&arena_arg_) {}
+
+		template <typename U>
+		arena_allocator(const arena_allocator<U>& other_) noexcept : arena_(other_.arena_) {}
+
+		static std::size_t max_size() noexcept
+		{
+			return (static_cast<std::size_t>(0) - static_cast<std::size_t>(1)) / sizeof(T);
+		}
+
+		T* allocate(const std::size_t n) const noexcept
+		{
+			if (n > max_size())
+			{
+				DBJ_ARENA_FAIL_POLICY("arena_allocator<T>::allocate() - Integer overflow.");
+			}
+			return static_cast<T*>(arena_->allocate(n * sizeof(T), alignof(T)));
+		}
+
+		void deallocate(T* const, const std::size_t) const noexcept
+		{
+			/* arena::reset() does this */
+		}
+
+		template <typename U>
+		friend bool operator==(arena_allocator const& left_, arena_allocator<U> const& right_) noexcept
+		{
+			return left_.arena_ == right_.arena_;
+		}
+
+		template <typename U>
+		friend bool operator!=(arena_allocator const& left_, arena_allocator<U> const& right_) noexcept
+		{
+			return left_.arena_ != right_.arena_;
+		}
+	}; // arena_allocator
+
+	// the dbj::buffer value_type equivalent living in the arena
+	template <typename T>
+	using arena_vector = std::vector<T, arena_allocator<T>>;
+
+} // namespace dbj::alloc
+
+#undef DBJ_ARENA_FAIL_POLICY
+
+#ifdef DBJ_ARENA_TESTING
+/*
+reset, alignment and the oversized allocations
+
+	clang++ -std=c++17 -DDBJ_ARENA_TESTING -x c++ nonstd/arena_allocator.h
+*/
+int main()
+{
+	using namespace dbj::alloc;
+
+	arena arena_(1024);
+
+	// alignment
+	for (std::size_t alignment_ = 1; alignment_ <= 4096; alignment_ *= 2)
+	{
+		void* ptr_ = arena_.allocate(3, alignment_);
+		assert(ptr_ && (reinterpret_cast<std::uintptr_t>(ptr_) % alignment_) == 0);
+		(void)ptr_;
+	}
+
+	// oversized, bigger than the block, gets the block of its own
+	char* big_ = static_cast<char*>(arena_.allocate(10 * 1024));
+	assert(big_);
+	big_[0] = big_[10 * 1024 - 1] = 'x';
+	const std::size_t capacity_ = arena_.capacity();
+	assert(capacity_ >= 10 * 1024 + 1024);
+
+	// reset rewinds, the blocks are kept and used again
+	arena_.reset();
+	assert(arena_.bytes_used() == 0);
+	int* first_ = arena_.create<int>(42);
+	assert(first_ && *first_ == 42);
+	for (int k = 0; k < 100; ++k)
+		arena_.allocate(64);
+	assert(arena_.capacity() == capacity_);
+
+	// through the STL
+	{
+		arena_vector<int> numbers_{arena_allocator<int>(arena_)};
+		for (int k = 0; k < 1000; ++k)
+			numbers_.push_back(k);
+		assert(numbers_[999] == 999);
+	}
+
+	arena_.release();
+	assert(arena_.capacity() == 0 && arena_.bytes_used() == 0);
+
+	::printf("\narena: all checks passed\n");
+	return 0;
+}
+#endif // DBJ_ARENA_TESTING
+
+#endif // DBJ_ARENA_ALLOCATOR_INC_
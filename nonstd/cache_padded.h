@@ -0,0 +1,161 @@
+#ifndef DBJ_CACHE_PADDED_INC_
+#define DBJ_CACHE_PADDED_INC_
+#ifdef __clang__
+#pragma clang system_header
+#endif // __clang__
+
+/*
+ (c) 2021 by dbj.org   -- LICENSE DBJ -- https://dbj.org/license_dbj/
+
+ false sharing free storage
+
+ two threads writing to two different variables on the same cache line
+ will make that line bounce between cores. cache_padded<T> is alone on
+ its line. by default it is alone on the pair of lines, since Intel
+ adjacent line prefetcher pulls them in two by two.
+
+	dbj::alloc::per_thread_array<unsigned long> hits_( std::thread::hardware_concurrency() );
+
+	// on each thread
+	hits_.local() += 1 ;
+
+	// on the reporting thread
+	auto total_ = hits_.sum();
+*/
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "aligned_allocator.h"
+#include "../dbj_nano_mutex.h"
+
+namespace dbj::alloc
+{
+	// destructive interference size, the adjacent lines pair
+	// std::hardware_destructive_interference_size is not used
+	// since it is ABI unstable, and GCC warns about it
+	constexpr inline std::size_t false_sharing_range = 2 * cache_line_size;
+
+	template <typename T, std::size_t ALIGNMENT = false_sharing_range>
+	struct alignas(ALIGNMENT) cache_padded final
+	{
+		static_assert(ALIGNMENT >= cache_line_size, "cache_padded -- ALIGNMENT must be at least the cache line size");
+
+		using value_type = T;
+
+		T value{};
+
+		cache_padded() = default;
+		explicit cache_padded(T const& value_arg_) : value(value_arg_) {}
+
+		T& get() noexcept { return value; }
+		T const& get() const noexcept { return value; }
+
+		T& operator*() noexcept { return value; }
+		T const& operator*() const noexcept { return value; }
+
+		T* operator->() noexcept { return &value; }
+		T const* operator->() const noexcept { return &value; }
+	}; // cache_padded
+
+	// DBJ NOTE: one thread index in the whole of dbj, the event log, the
+	// trace and the per thread slots must agree, see dbj_nano_mutex.h
+	using ::dbj::nano::this_thread_index;
+
+	/*
+	one cache padded slot per thread
+
+	local() maps the calling thread to the slot this_thread_index() % size()
+	slot is exclusive to its thread only if there are at least as many slots
+	as there are threads using it, otherwise make T atomic
+
+	reading the other threads slots while they write, is your problem
+	make T atomic or read after join
+	*/
+	template <typename T, std::size_t ALIGNMENT = false_sharing_range>
+	class per_thread_array final
+	{
+	public:
+		using slot_type = cache_padded<T, ALIGNMENT>;
+		using storage_type = std::vector<slot_type, aligned_allocator<slot_type, ALIGNMENT>>;
+
+	private:
+		storage_type slots_;
+
+	public:
+		explicit per_thread_array(std::size_t count_ = std::thread::hardware_concurrency())
+			: slots_(count_ > 0 ? count_ : 1)
+		{
+		}
+
+		per_thread_array(per_thread_array const&) = delete;
+		per_thread_array& operator=(per_thread_array const&) = delete;
+
+		std::size_t size() const noexcept { return slots_.size(); }
+
+		T& operator[](std::size_t idx_) noexcept
+		{
+			assert(idx_ < slots_.size());
+			return slots_[idx_].value;
+		}
+
+		T const& operator[](std::size_t idx_) const noexcept
+		{
+			assert(idx_ < slots_.size());
+			return slots_[idx_].value;
+		}
+
+		// the calling thread slot
+		T& local() noexcept
+		{
+			return slots_[this_thread_index() % slots_.size()].value;
+		}
+
+		template <typename F>
+		void for_each(F&& fun_)
+		{
+			for (auto& slot_ : slots_)
+				fun_(slot_.value);
+		}
+
+		// op_ is R (R, T const &)
+		template <typename R, typename OP>
+		R reduce(R init_, OP&& op_) const
+		{
+			for (auto const& slot_ : slots_)
+				init_ = op_(init_, slot_.value);
+			return init_;
+		}
+
+		// aggregate with +
+		// for atomic T it is T::value_type
+		auto sum() const
+		{
+			if constexpr (is_atomic<T>::value)
+			{
+				using R = typename T::value_type;
+				return reduce(R{}, [](R left_, T const& right_) { return R(left_ + right_.load(std::memory_order_relaxed)); });
+			}
+			else
+			{
+				return reduce(T{}, [](T left_, T const& right_) { return T(left_ + right_); });
+			}
+		}
+
+	private:
+		template <typename X>
+		struct is_atomic : std::false_type {};
+
+		template <typename X>
+		struct is_atomic<std::atomic<X>> : std::true_type {};
+
+	}; // per_thread_array
+
+} // namespace dbj::alloc
+
+#endif // DBJ_CACHE_PADDED_INC_
@@ -0,0 +1,568 @@
+#ifndef DBJ_BENCH_INC_
+#define DBJ_BENCH_INC_
+
+#ifdef __clang__
+#pragma clang system_header
+#endif // __clang__
+
+/*
+ (c) 2021 by dbj.org   -- LICENSE DBJ -- https://dbj.org/license_dbj/
+
+ dbj micro benchmarks
+
+ no exceptions, no iostreams, on the dbj::stopwatch::cycles
+
+	#include "nonstd/dbj_bench.h"
+
+	DBJ_BENCH(large_std_string)
+	{
+		// iterations is given by the harness
+		for (std::uint64_t k = 0; k < iterations; ++k)
+		{
+			std::string s_(15360, '?');
+			dbj::bench::do_not_optimize(s_);
+		}
+	}
+
+	DBJ_BENCH_MAIN
+
+ for each benchmark:
+
+	warm-up, growing the iterations until one batch takes the min batch time
+	then the samples, each one batch, timed as a whole
+	the statistics of the per iteration nanoseconds: median, MAD, p99, min, mean
+
+ command line
+
+	--filter=text       only the benchmarks with the text in the name
+	--samples=N         default 31
+	--min-ms=N          min batch time, default 5
+	--warmup-ms=N       default 100
+	--csv=file          results as CSV
+	--json=file         results as JSON
+	--baseline=file     CSV from the previous run, medians are compared
+	--threshold=N       percent slower than the baseline, which is the regression, default 5
+
+ the exit code is 1 if there is a regression, 2 if the file could not be opened
+
+ the warm-up stops at DBJ_BENCH_MAX_ITERATIONS per batch or after
+ DBJ_BENCH_BUDGET_MS. if one batch still did not take the min batch time
+ the body is too fast to measure, the optimiser removed it most likely,
+ the result says so and it is never the regression.
+
+ the CSV written is the CSV read as the baseline, thus
+
+	a.out --csv=base.csv
+	# change the code
+	a.out --baseline=base.csv
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "dbj_timer.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#ifndef DBJ_BENCH_SAMPLES
+#define DBJ_BENCH_SAMPLES 31
+#endif
+
+#ifndef DBJ_BENCH_MIN_MS
+#define DBJ_BENCH_MIN_MS 5
+#endif
+
+#ifndef DBJ_BENCH_WARMUP_MS
+#define DBJ_BENCH_WARMUP_MS 100
+#endif
+
+#ifndef DBJ_BENCH_THRESHOLD
+#define DBJ_BENCH_THRESHOLD 5
+#endif
+
+// the most iterations of one batch
+#ifndef DBJ_BENCH_MAX_ITERATIONS
+#define DBJ_BENCH_MAX_ITERATIONS (std::uint64_t(1) << 40)
+#endif
+
+// the wall time budget of the warm-up, per benchmark
+#ifndef DBJ_BENCH_BUDGET_MS
+#define DBJ_BENCH_BUDGET_MS 10000
+#endif
+
+namespace dbj::bench
+{
+	/*
+	the compiler must assume value_ is read, and memory is written
+	thus the computation of value_ can not be removed
+	*/
+	template <typename T>
+	inline void do_not_optimize(T const& value_) noexcept
+	{
+#ifdef _MSC_VER
+		// DBJ NOTE: no inline asm on x64 MSVC, volatile read is the closest
+		const volatile char* sink_ = reinterpret_cast<const volatile char*>(&value_);
+		(void)*sink_;
+		_ReadWriteBarrier();
+#else
+		asm volatile("" : : "r,m"(value_) : "memory");
+#endif
+	}
+
+	template <typename T>
+	inline void do_not_optimize(T& value_) noexcept
+	{
+#ifdef _MSC_VER
+		const volatile char* sink_ = reinterpret_cast<const volatile char*>(&value_);
+		(void)*sink_;
+		_ReadWriteBarrier();
+#else
+#if defined(__clang__)
+		asm volatile("" : "+r,m"(value_) : : "memory");
+#else
+		asm volatile("" : "+m,r"(value_) : : "memory");
+#endif
+#endif
+	}
+
+	// all the writes to memory are done before this
+	inline void clobber_memory() noexcept
+	{
+#ifdef _MSC_VER
+		_ReadWriteBarrier();
+#else
+		asm volatile("" : : : "memory");
+#endif
+	}
+
+	// nanoseconds per iteration
+	struct result final
+	{
+		std::uint64_t iterations{};
+		unsigned samples{};
+		double median{};
+		double mad{};
+		double p99{};
+		double min{};
+		double mean{};
+		// from the baseline, 0 if not there
+		double baseline_median{};
+		bool regression{};
+		// the batch never took the min batch time, the numbers are noise
+		bool too_fast{};
+	};
+
+	using function_type = void (*)(std::uint64_t iterations);
+
+	/*
+	one per DBJ_BENCH, static, thus registered before main()
+	in the order of the definitions, per translation unit
+	*/
+	struct entry final
+	{
+		const char* name{};
+		function_type function{};
+		result last{};
+		bool done{};
+		entry* next{};
+
+		entry(const char* name_arg_, function_type function_arg_) noexcept;
+
+		entry(entry const&) = delete;
+		entry& operator=(entry const&) = delete;
+	};
+
+	struct registry_type final
+	{
+		entry* head{};
+		entry* tail{};
+	};
+
+	inline registry_type& registry() noexcept
+	{
+		static registry_type registry_{};
+		return registry_;
+	}
+
+	inline entry::entry(const char* name_arg_, function_type function_arg_) noexcept
+		: name(name_arg_), function(function_arg_)
+	{
+		registry_type& registry_ = registry();
+		if (registry_.tail)
+			registry_.tail->next = this;
+		else
+			registry_.head = this;
+		registry_.tail = this;
+	}
+
+	// F is void ( entry & )
+	template <typename F>
+	inline void for_each(F&& fun_)
+	{
+		for (entry* walker_ = registry().head; walker_; walker_ = walker_->next)
+			fun_(*walker_);
+	}
+
+	struct settings final
+	{
+		const char* filter{};
+		unsigned samples{DBJ_BENCH_SAMPLES};
+		unsigned min_ms{DBJ_BENCH_MIN_MS};
+		unsigned warmup_ms{DBJ_BENCH_WARMUP_MS};
+		const char* csv{};
+		const char* json{};
+		const char* baseline{};
+		double threshold{DBJ_BENCH_THRESHOLD};
+	};
+
+	namespace detail
+	{
+		// nanoseconds of one batch
+		inline double time_batch(function_type function_, std::uint64_t iterations_) noexcept
+		{
+			stopwatch::cycles stopwatch_{};
+			function_(iterations_);
+			clobber_memory();
+			return stopwatch_.elapsed<double, std::chrono::duration<double, std::nano>>();
+		}
+
+		// sorted_ must not be empty
+		inline double percentile(std::vector<double> const& sorted_, double p_) noexcept
+		{
+			const double position_ = p_ * double(sorted_.size() - 1);
+			const std::size_t below_ = std::size_t(position_);
+			if (below_ + 1 >= sorted_.size())
+				return sorted_.back();
+			const double fraction_ = position_ - double(below_);
+			return sorted_[below_] + fraction_ * (sorted_[below_ + 1] - sorted_[below_]);
+		}
+
+		// values_ are sorted on return
+		inline void statistics(std::vector<double>& values_, result& result_) noexcept
+		{
+			std::sort(values_.begin(), values_.end());
+			result_.median = percentile(values_, 0.5);
+			result_.p99 = percentile(values_, 0.99);
+			result_.min = values_.front();
+
+			double sum_{};
+			for (double v_ : values_)
+				sum_ += v_;
+			result_.mean = sum_ / double(values_.size());
+
+			// median of the absolute deviations from the median
+			std::vector<double> deviations_(values_.size());
+			for (std::size_t k = 0; k < values_.size(); ++k)
+				deviations_[k] = values_[k] > result_.median ? values_[k] - result_.median : result_.median - values_[k];
+			std::sort(deviations_.begin(), deviations_.end());
+			result_.mad = percentile(deviations_, 0.5);
+		}
+
+		inline bool starts_with(const char* arg_, const char* prefix_, const char** value_) noexcept
+		{
+			const std::size_t len_ = std::strlen(prefix_);
+			if (std::strncmp(arg_, prefix_, len_) != 0)
+				return false;
+			*value_ = arg_ + len_;
+			return true;
+		}
+	} // namespace detail
+
+	inline result measure(function_type function_, settings const& settings_) noexcept
+	{
+		result result_{};
+		const double min_ns_ = double(settings_.min_ms) * 1e6;
+		const double warmup_ns_ = double(settings_.warmup_ms) * 1e6;
+
+		// warm-up and the iteration count, together
+		// DBJ NOTE: bounded, the constant time body never reaches the min batch time
+		const std::uint64_t max_iterations_ = DBJ_BENCH_MAX_ITERATIONS;
+		stopwatch::monotonic budget_{};
+		std::uint64_t iterations_ = 1;
+		double warm_ns_{};
+		for (;;)
+		{
+			const double batch_ns_ = detail::time_batch(function_, iterations_);
+			warm_ns_ += batch_ns_;
+			const bool out_of_budget_ =
+				budget_.elapsed<std::uint64_t, std::chrono::milliseconds>() >= DBJ_BENCH_BUDGET_MS;
+			if (batch_ns_ >= min_ns_)
+			{
+				if (warm_ns_ >= warmup_ns_ || out_of_budget_)
+					break;
+				continue; // keep warming up with the same count
+			}
+			if (iterations_ >= max_iterations_ || out_of_budget_)
+			{
+				result_.too_fast = true;
+				break;
+			}
+			// aim for the min batch time, at most 10x at once
+			std::uint64_t next_ = batch_ns_ > 0 ? std::uint64_t(double(iterations_) * min_ns_ * 1.2 / batch_ns_) : 0;
+			if (next_ <= iterations_)
+				next_ = iterations_ * 2;
+			if (next_ > iterations_ * 10)
+				next_ = iterations_ * 10;
+			if (next_ > max_iterations_)
+				next_ = max_iterations_;
+			iterations_ = next_;
+		}
+
+		const unsigned samples_count_ = settings_.samples > 0 ? settings_.samples : 1;
+		std::vector<double> samples_(samples_count_);
+		for (double& sample_ : samples_)
+			sample_ = detail::time_batch(function_, iterations_) / double(iterations_);
+
+		result_.iterations = iterations_;
+		result_.samples = samples_count_;
+		detail::statistics(samples_, result_);
+		return result_;
+	}
+
+	/*
+	the CSV written by write_csv()
+	fun_ is void (const char * name, double median)
+	returns false if the file could not be opened
+	*/
+	template <typename F>
+	inline bool read_baseline(const char* path_, F&& fun_)
+	{
+		FILE* file_ = std::fopen(path_, "r");
+		if (!file_)
+			return false;
+		char line_[512]{};
+		bool header_ = true;
+		while (std::fgets(line_, sizeof(line_), file_))
+		{
+			if (header_)
+			{
+				header_ = false;
+				continue;
+			}
+			char name_[256]{};
+			double median_{};
+			if (2 == std::sscanf(line_, "%255[^,],%*[^,],%*[^,],%lf", name_, &median_))
+				fun_(static_cast<const char*>(name_), median_);
+		}
+		std::fclose(file_);
+		return true;
+	}
+
+	inline bool write_csv(const char* path_) noexcept
+	{
+		FILE* file_ = std::fopen(path_, "w");
+		if (!file_)
+			return false;
+		std::fprintf(file_, "name,iterations,samples,median_ns,mad_ns,p99_ns,min_ns,mean_ns\n");
+		for_each([file_](entry const& entry_) {
+			if (!entry_.done)
+				return;
+			result const& r_ = entry_.last;
+			std::fprintf(file_, "%s,%llu,%u,%.4f,%.4f,%.4f,%.4f,%.4f\n",
+						 entry_.name, (unsigned long long)r_.iterations, r_.samples,
+						 r_.median, r_.mad, r_.p99, r_.min, r_.mean);
+		});
+		std::fclose(file_);
+		return true;
+	}
+
+	// names are C++ identifiers, nothing to escape
+	inline bool write_json(const char* path_) noexcept
+	{
+		FILE* file_ = std::fopen(path_, "w");
+		if (!file_)
+			return false;
+		std::fprintf(file_, "{\n\"benchmarks\": [");
+		bool first_ = true;
+		for_each([&](entry const& entry_) {
+			if (!entry_.done)
+				return;
+			result const& r_ = entry_.last;
+			std::fprintf(file_,
+						 "%s\n{ \"name\": \"%s\", \"iterations\": %llu, \"samples\": %u, "
+						 "\"median_ns\": %.4f, \"mad_ns\": %.4f, \"p99_ns\": %.4f, \"min_ns\": %.4f, \"mean_ns\": %.4f",
+						 first_ ? "" : ",", entry_.name, (unsigned long long)r_.iterations, r_.samples,
+						 r_.median, r_.mad, r_.p99, r_.min, r_.mean);
+			if (r_.too_fast)
+				std::fprintf(file_, ", \"too_fast\": true");
+			if (r_.baseline_median > 0)
+				std::fprintf(file_, ", \"baseline_median_ns\": %.4f, \"regression\": %s",
+							 r_.baseline_median, r_.regression ? "true" : "false");
+			std::fprintf(file_, " }");
+			first_ = false;
+		});
+		std::fprintf(file_, "\n]\n}\n");
+		std::fclose(file_);
+		return true;
+	}
+
+	/*
+	returns the exit code
+	0 ok, 1 regression against the baseline, 2 file could not be opened
+	*/
+	inline int run(settings const& settings_) noexcept
+	{
+		const auto& calibration_ = stopwatch::tsc::calibrated();
+		std::printf("\ndbj bench, %s, %u samples, min batch %u ms\n",
+					calibration_.is_tsc ? "invariant tsc" : "steady_clock", settings_.samples, settings_.min_ms);
+		std::printf("\n%-40s %14s %12s %12s %12s %12s", "benchmark", "iterations", "median ns", "MAD ns", "p99 ns", "baseline");
+
+		for_each([&](entry& entry_) {
+			if (settings_.filter && !std::strstr(entry_.name, settings_.filter))
+				return;
+			entry_.last = measure(entry_.function, settings_);
+			entry_.done = true;
+		});
+
+		int retval_ = 0;
+		if (settings_.baseline)
+		{
+			const bool read_ = read_baseline(settings_.baseline, [&](const char* name_, double median_) {
+				for_each([&](entry& entry_) {
+					if (entry_.done && 0 == std::strcmp(entry_.name, name_))
+					{
+						entry_.last.baseline_median = median_;
+						entry_.last.regression = !entry_.last.too_fast &&
+												 entry_.last.median > median_ * (1.0 + settings_.threshold / 100.0);
+					}
+				});
+			});
+			if (!read_)
+			{
+				std::perror(" (" __FILE__ ") dbj::bench::run() -- can not read the baseline");
+				retval_ = 2;
+			}
+		}
+
+		for_each([&](entry const& entry_) {
+			if (!entry_.done)
+				return;
+			result const& r_ = entry_.last;
+			std::printf("\n%-40s %14llu %12.3f %12.3f %12.3f",
+						entry_.name, (unsigned long long)r_.iterations, r_.median, r_.mad, r_.p99);
+			if (r_.too_fast)
+				std::printf("  TOO FAST TO MEASURE");
+			if (r_.baseline_median > 0)
+			{
+				std::printf(" %+11.2f%%%s", 100.0 * (r_.median - r_.baseline_median) / r_.baseline_median,
+							r_.regression ? "  REGRESSION" : "");
+				if (r_.regression && retval_ == 0)
+					retval_ = 1;
+			}
+		});
+		std::printf("\n");
+
+		if (settings_.csv && !write_csv(settings_.csv))
+		{
+			std::perror(" (" __FILE__ ") dbj::bench::run() -- can not write the CSV");
+			retval_ = 2;
+		}
+		if (settings_.json && !write_json(settings_.json))
+		{
+			std::perror(" (" __FILE__ ") dbj::bench::run() -- can not write the JSON");
+			retval_ = 2;
+		}
+		return retval_;
+	}
+
+	// unknown arguments are ignored
+	inline int run(int argc, char** argv) noexcept
+	{
+		settings settings_{};
+		for (int k = 1; k < argc; ++k)
+		{
+			const char* value_{};
+			if (detail::starts_with(argv[k], "--filter=", &value_))
+				settings_.filter = value_;
+			else if (detail::starts_with(argv[k], "--samples=", &value_))
+				settings_.samples = unsigned(std::atoi(value_));
+			else if (detail::starts_with(argv[k], "--min-ms=", &value_))
+				settings_.min_ms = unsigned(std::atoi(value_));
+			else if (detail::starts_with(argv[k], "--warmup-ms=", &value_))
+				settings_.warmup_ms = unsigned(std::atoi(value_));
+			else if (detail::starts_with(argv[k], "--csv=", &value_))
+				settings_.csv = value_;
+			else if (detail::starts_with(argv[k], "--json=", &value_))
+				settings_.json = value_;
+			else if (detail::starts_with(argv[k], "--baseline=", &value_))
+				settings_.baseline = value_;
+			else if (detail::starts_with(argv[k], "--threshold=", &value_))
+				settings_.threshold = std::atof(value_);
+		}
+		return run(settings_);
+	}
+
+} // namespace dbj::bench
+
+#define DBJ_BENCH_CONCAT_(A_, B_) A_##B_
+
+/*
+defines the function void (std::uint64_t iterations), and registers it
+the body follows the macro
+*/
+#define DBJ_BENCH(NAME_)                                                                          \
+	static void DBJ_BENCH_CONCAT_(dbj_bench_, NAME_)(std::uint64_t iterations);                 \
+	static ::dbj::bench::entry DBJ_BENCH_CONCAT_(dbj_bench_entry_, NAME_){                       \
+		#NAME_, &DBJ_BENCH_CONCAT_(dbj_bench_, NAME_)};                                           \
+	static void DBJ_BENCH_CONCAT_(dbj_bench_, NAME_)([[maybe_unused]] std::uint64_t iterations)
+
+#define DBJ_BENCH_MAIN                           \
+	int main(int argc, char** argv)              \
+	{                                            \
+		return ::dbj::bench::run(argc, argv);    \
+	}
+
+#ifdef DBJ_BENCH_TESTING
+/*
+the std::string and std::vector half of the dbj_nanostring.h benchmark
+
+	clang++ -std=c++17 -O2 -DDBJ_BENCH_TESTING -x c++ nonstd/dbj_bench.h
+	a.out --csv=base.csv
+	a.out --baseline=base.csv
+*/
+#include <string>
+
+DBJ_BENCH(large_std_string)
+{
+	for (std::uint64_t k = 0; k < iterations; ++k)
+	{
+		std::string specimen_(15360, '?');
+		dbj::bench::do_not_optimize(specimen_);
+	}
+}
+
+DBJ_BENCH(large_std_vector)
+{
+	for (std::uint64_t k = 0; k < iterations; ++k)
+	{
+		std::vector<char> specimen_(15360, '?');
+		dbj::bench::do_not_optimize(specimen_);
+	}
+}
+
+// the store is hoisted out of the loop, the batch takes the constant time
+inline int dbj_bench_testing_store_{};
+
+DBJ_BENCH(constant_time)
+{
+	for (std::uint64_t k = 0; k < iterations; ++k)
+		dbj_bench_testing_store_ = 1;
+}
+
+DBJ_BENCH(empty_loop)
+{
+	for (std::uint64_t k = 0; k < iterations; ++k)
+		dbj::bench::do_not_optimize(k);
+}
+
+DBJ_BENCH_MAIN
+#endif // DBJ_BENCH_TESTING
+
+#endif // DBJ_BENCH_INC_
@@ -0,0 +1,391 @@
+#ifndef DBJ_HISTOGRAM_INC_
+#define DBJ_HISTOGRAM_INC_
+
+#ifdef __clang__
+#pragma clang system_header
+#endif // __clang__
+
+/*
+ (c) 2021 by dbj.org   -- LICENSE DBJ -- https://dbj.org/license_dbj/
+
+ log linear latency histograms, HDR like
+
+ for the tail latency of the production code paths. constant memory no
+ matter how many values are recorded, no locks, no allocation on record.
+
+ each power of two range is split in 2^PRECISION linear buckets, thus
+ the value is kept with the relative error below 2^-PRECISION. the
+ default 5 is 32 buckets per power of two, about 3%, for 1920 buckets,
+ 15KB, covering the whole 64 bit range. values bellow 64 are exact.
+
+	// one per code path, all the threads record into it
+	static dbj::stats::per_thread_histogram<> latency_;
+
+	{
+		dbj::stats::scoped_latency timing_(latency_);
+		// ... the code path ...
+	}
+	// or
+	latency_.record( stopwatch_.elapsed() );
+
+	// on the reporting thread
+	dbj::stats::histogram<> all_;
+	latency_.merge_into(all_);
+	auto p99_ = all_.percentile(99.0);
+	all_.report(stdout, "the code path");
+
+ the units are what is recorded, for the stopwatch engines that is
+ nanoseconds. percentile() is the highest value of its bucket, never
+ above the max recorded.
+
+ counters are relaxed atomics. merge_into() while the others record is
+ allowed, the result is not the snapshot, but nothing is seen partially.
+*/
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+
+#include "cache_padded.h"
+#include "dbj_timer.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace dbj::stats
+{
+	// index of the highest set bit, value_ must not be 0
+	inline unsigned highest_bit(std::uint64_t value_) noexcept
+	{
+		assert(value_ != 0);
+#ifdef _MSC_VER
+		unsigned long index_{};
+		_BitScanReverse64(&index_, value_);
+		return unsigned(index_);
+#else
+		return 63u - unsigned(__builtin_clzll(value_));
+#endif
+	}
+
+	template <unsigned PRECISION = 5>
+	class histogram final
+	{
+		static_assert(PRECISION >= 1 && PRECISION <= 16, "histogram -- PRECISION must be in [1,16]");
+
+	public:
+		static constexpr std::size_t sub_buckets = std::size_t(1) << PRECISION;
+		static constexpr std::size_t bucket_count = (65 - PRECISION) * sub_buckets;
+
+		/*
+		bellow 2 * sub_buckets the index is the value
+		above, the top PRECISION + 1 bits of the value, and the shift
+		*/
+		static std::size_t index_of(std::uint64_t value_) noexcept
+		{
+			if (value_ < 2 * sub_buckets)
+				return std::size_t(value_);
+			const unsigned shift_ = highest_bit(value_) - PRECISION;
+			return (std::size_t(shift_) << PRECISION) + std::size_t(value_ >> shift_);
+		}
+
+		static constexpr std::uint64_t lowest_of(std::size_t index_) noexcept
+		{
+			if (index_ < 2 * sub_buckets)
+				return index_;
+			const unsigned shift_ = unsigned(index_ >> PRECISION) - 1;
+			return std::uint64_t(index_ - (std::size_t(shift_) << PRECISION)) << shift_;
+		}
+
+		static constexpr std::uint64_t highest_of(std::size_t index_) noexcept
+		{
+			if (index_ < 2 * sub_buckets)
+				return index_;
+			const unsigned shift_ = unsigned(index_ >> PRECISION) - 1;
+			return lowest_of(index_) + ((std::uint64_t(1) << shift_) - 1);
+		}
+
+	private:
+		std::atomic<std::uint64_t> buckets_[bucket_count]{};
+		std::atomic<std::uint64_t> count_{0};
+		std::atomic<std::uint64_t> sum_{0};
+		std::atomic<std::uint64_t> min_{UINT64_MAX};
+		std::atomic<std::uint64_t> max_{0};
+
+		static void atomic_min(std::atomic<std::uint64_t>& target_, std::uint64_t value_) noexcept
+		{
+			std::uint64_t current_ = target_.load(std::memory_order_relaxed);
+			while (value_ < current_ &&
+				   !target_.compare_exchange_weak(current_, value_, std::memory_order_relaxed))
+			{
+			}
+		}
+
+		static void atomic_max(std::atomic<std::uint64_t>& target_, std::uint64_t value_) noexcept
+		{
+			std::uint64_t current_ = target_.load(std::memory_order_relaxed);
+			while (current_ < value_ &&
+				   !target_.compare_exchange_weak(current_, value_, std::memory_order_relaxed))
+			{
+			}
+		}
+
+	public:
+		histogram() noexcept = default;
+
+		histogram(histogram const&) = delete;
+		histogram& operator=(histogram const&) = delete;
+
+		void record(std::uint64_t value_, std::uint64_t times_ = 1) noexcept
+		{
+			buckets_[index_of(value_)].fetch_add(times_, std::memory_order_relaxed);
+			count_.fetch_add(times_, std::memory_order_relaxed);
+			sum_.fetch_add(value_ * times_, std::memory_order_relaxed);
+			atomic_min(min_, value_);
+			atomic_max(max_, value_);
+		}
+
+		std::uint64_t count() const noexcept { return count_.load(std::memory_order_relaxed); }
+		std::uint64_t max() const noexcept { return max_.load(std::memory_order_relaxed); }
+
+		std::uint64_t min() const noexcept
+		{
+			return count() > 0 ? min_.load(std::memory_order_relaxed) : 0;
+		}
+
+		double mean() const noexcept
+		{
+			const std::uint64_t count_now_ = count();
+			return count_now_ > 0 ? double(sum_.load(std::memory_order_relaxed)) / double(count_now_) : 0.0;
+		}
+
+		std::uint64_t bucket(std::size_t index_) const noexcept
+		{
+			assert(index_ < bucket_count);
+			return buckets_[index_].load(std::memory_order_relaxed);
+		}
+
+		// percent_ is in [0,100], 0 if empty
+		std::uint64_t percentile(double percent_) const noexcept
+		{
+			const std::uint64_t count_now_ = count();
+			if (count_now_ == 0)
+				return 0;
+			if (percent_ <= 0.0)
+				return min();
+			if (percent_ > 100.0)
+				percent_ = 100.0;
+
+			// the rank of the value, 1 based
+			std::uint64_t rank_ = std::uint64_t(percent_ / 100.0 * double(count_now_) + 0.5);
+			if (rank_ < 1)
+				rank_ = 1;
+
+			const std::uint64_t max_now_ = max();
+			std::uint64_t seen_{};
+			for (std::size_t k = 0; k < bucket_count; ++k)
+			{
+				seen_ += bucket(k);
+				if (seen_ >= rank_)
+				{
+					const std::uint64_t highest_ = highest_of(k);
+					return highest_ < max_now_ ? highest_ : max_now_;
+				}
+			}
+			return max_now_;
+		}
+
+		// adds the other one to this one
+		void merge(histogram const& other_) noexcept
+		{
+			if (other_.count() == 0)
+				return;
+			for (std::size_t k = 0; k < bucket_count; ++k)
+			{
+				const std::uint64_t other_bucket_ = other_.bucket(k);
+				if (other_bucket_)
+					buckets_[k].fetch_add(other_bucket_, std::memory_order_relaxed);
+			}
+			count_.fetch_add(other_.count(), std::memory_order_relaxed);
+			sum_.fetch_add(other_.sum_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+			atomic_min(min_, other_.min_.load(std::memory_order_relaxed));
+			atomic_max(max_, other_.max());
+		}
+
+		void reset() noexcept
+		{
+			for (auto& bucket_ : buckets_)
+				bucket_.store(0, std::memory_order_relaxed);
+			count_.store(0, std::memory_order_relaxed);
+			sum_.store(0, std::memory_order_relaxed);
+			min_.store(UINT64_MAX, std::memory_order_relaxed);
+			max_.store(0, std::memory_order_relaxed);
+		}
+
+		// one line, divisor_ 1000.0 is nanoseconds as microseconds
+		void report(FILE* out_, const char* title_, double divisor_ = 1000.0) const noexcept
+		{
+			::fprintf(out_, "\n%-32s count: %12llu  min: %10.3f  p50: %10.3f  p90: %10.3f  p99: %10.3f  p99.9: %10.3f  max: %10.3f",
+					  title_, (unsigned long long)count(),
+					  min() / divisor_, percentile(50.0) / divisor_, percentile(90.0) / divisor_,
+					  percentile(99.0) / divisor_, percentile(99.9) / divisor_, max() / divisor_);
+		}
+	}; // histogram
+
+	/*
+	one cache padded histogram per thread, the thread records into its own
+	more threads than slots is fine, they share the slot
+	*/
+	template <unsigned PRECISION = 5>
+	class per_thread_histogram final
+	{
+	public:
+		using histogram_type = histogram<PRECISION>;
+
+	private:
+		dbj::alloc::per_thread_array<histogram_type> slots_;
+
+	public:
+		explicit per_thread_histogram(std::size_t slots_count_ = std::thread::hardware_concurrency())
+			: slots_(slots_count_)
+		{
+		}
+
+		per_thread_histogram(per_thread_histogram const&) = delete;
+		per_thread_histogram& operator=(per_thread_histogram const&) = delete;
+
+		void record(std::uint64_t value_, std::uint64_t times_ = 1) noexcept
+		{
+			slots_.local().record(value_, times_);
+		}
+
+		// the calling thread histogram
+		histogram_type& local() noexcept { return slots_.local(); }
+
+		std::size_t size() const noexcept { return slots_.size(); }
+
+		// all the slots added to the target_
+		void merge_into(histogram_type& target_) const noexcept
+		{
+			for (std::size_t k = 0; k < slots_.size(); ++k)
+				target_.merge(slots_[k]);
+		}
+
+		void reset() noexcept
+		{
+			slots_.for_each([](histogram_type& slot_) { slot_.reset(); });
+		}
+	}; // per_thread_histogram
+
+	/*
+	records the elapsed nanoseconds on the destruction
+	H is histogram or per_thread_histogram
+	*/
+	template <typename H, typename ENGINE = dbj::stopwatch::cycles>
+	class scoped_latency final
+	{
+		H& target_;
+		ENGINE stopwatch_{};
+
+	public:
+		explicit scoped_latency(H& target_arg_) noexcept : target_(target_arg_) {}
+
+		~scoped_latency()
+		{
+			target_.record(static_cast<std::uint64_t>(
+				stopwatch_.template elapsed<long long, std::chrono::nanoseconds>()));
+		}
+
+		scoped_latency(scoped_latency const&) = delete;
+		scoped_latency& operator=(scoped_latency const&) = delete;
+	};
+
+	template <typename H>
+	scoped_latency(H&) -> scoped_latency<H>;
+
+} // namespace dbj::stats
+
+#ifdef DBJ_HISTOGRAM_TESTING
+/*
+percentiles against the exact ones from the sorted values, and the
+per thread recording
+
+	clang++ -std=c++17 -O2 -DDBJ_HISTOGRAM_TESTING -x c++ nonstd/dbj_histogram.h
+*/
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace dbj::stats::histogram_testing
+{
+	// returns false if the relative error is above the precision
+	inline bool accuracy_test()
+	{
+		std::mt19937_64 random_{42};
+		// log normal, the usual latency shape, in nanoseconds
+		std::lognormal_distribution<double> distribution_(9.0, 1.5);
+
+		static histogram<> histogram_{};
+		std::vector<std::uint64_t> exact_(1000000);
+		for (auto& value_ : exact_)
+		{
+			value_ = std::uint64_t(distribution_(random_));
+			histogram_.record(value_);
+		}
+		std::sort(exact_.begin(), exact_.end());
+
+		bool ok_ = histogram_.count() == exact_.size() && histogram_.max() == exact_.back();
+		for (double percent_ : {1.0, 50.0, 90.0, 99.0, 99.9, 99.99})
+		{
+			const std::uint64_t expected_ = exact_[std::size_t(percent_ / 100.0 * double(exact_.size() - 1))];
+			const std::uint64_t got_ = histogram_.percentile(percent_);
+			const double error_ = expected_ ? (double(got_) - double(expected_)) / double(expected_) : 0.0;
+			::printf("\np%-6.2f exact: %12llu  histogram: %12llu  error: %+8.4f%%",
+					 percent_, (unsigned long long)expected_, (unsigned long long)got_, 100.0 * error_);
+			ok_ &= (error_ < 1.0 / histogram<>::sub_buckets + 1e-9) && (error_ > -1.0 / histogram<>::sub_buckets - 1e-9);
+		}
+		::printf("\naccuracy test: %s\n", ok_ ? "OK" : "FAILED");
+		return ok_;
+	}
+
+	// returns false if something is lost
+	inline bool per_thread_test(unsigned threads_ = std::thread::hardware_concurrency(), unsigned per_thread_ = 200000)
+	{
+		if (threads_ < 2)
+			threads_ = 2;
+		static per_thread_histogram<> latency_{};
+		std::vector<std::thread> workers_;
+		for (unsigned t_ = 0; t_ < threads_; ++t_)
+			workers_.emplace_back([per_thread_] {
+				volatile unsigned sink_{};
+				for (unsigned k = 0; k < per_thread_; ++k)
+				{
+					scoped_latency timing_(latency_);
+					sink_ = sink_ + k;
+				}
+			});
+		for (auto& worker_ : workers_)
+			worker_.join();
+
+		static histogram<> all_{};
+		latency_.merge_into(all_);
+		all_.report(stdout, "scoped_latency (us)");
+
+		const bool ok_ = all_.count() == std::uint64_t(threads_) * per_thread_;
+		::printf("\nper thread test: %s\n", ok_ ? "OK" : "FAILED");
+		return ok_;
+	}
+} // namespace dbj::stats::histogram_testing
+
+int main()
+{
+	bool ok_ = dbj::stats::histogram_testing::accuracy_test();
+	ok_ &= dbj::stats::histogram_testing::per_thread_test();
+	return ok_ ? 0 : 1;
+}
+#endif // DBJ_HISTOGRAM_TESTING
+
+#endif // DBJ_HISTOGRAM_INC_
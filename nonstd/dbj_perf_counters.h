@@ -0,0 +1,286 @@
+#ifndef DBJ_PERF_COUNTERS_INC_
+#define DBJ_PERF_COUNTERS_INC_
+
+#ifdef __clang__
+#pragma clang system_header
+#endif // __clang__
+
+/*
+ (c) 2021 by dbj.org   -- LICENSE DBJ -- https://dbj.org/license_dbj/
+
+ the hardware performance counters, around the measured region
+
+ the wall clock says how long, the counters say why. instructions per
+ cycle, cache misses and branch misses, of the calling thread, user mode.
+
+	dbj::stopwatch::counters counters_{};
+	// ... the kernel ...
+	dbj::stopwatch::counters::sample sample_ = counters_.stop();
+	sample_.print(stdout, "the kernel");
+
+	if (sample_.has(dbj::stopwatch::counters::cache_misses)) ...
+
+ Linux perf_event_open only. when the counters are not allowed, in the
+ container, with perf_event_paranoid above 2, or on the VM without the
+ PMU, or not on Linux, the sample has only the elapsed time and the
+ print says n/a. nothing fails.
+
+ opening the counters is a few system calls, thus keep the counters
+ object around the hot loop, not inside it. start() measures again.
+
+ when there are more counters wanted than the cpu has, the kernel
+ multiplexes them, the values are then scaled by the time enabled over
+ the time running. sample::scaled says so.
+*/
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#include "dbj_timer.h"
+
+#if defined(__linux__)
+#define DBJ_PERF_COUNTERS_LINUX 1
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace dbj::stopwatch
+{
+	class counters final
+	{
+	public:
+		enum kind : unsigned
+		{
+			instructions,
+			cycles,
+			cache_misses,
+			branch_misses,
+			kind_count
+		};
+
+		static constexpr const char* names[kind_count]{
+			"instructions", "cycles", "cache misses", "branch misses"};
+
+		struct sample final
+		{
+			double elapsed_ns{};
+			std::uint64_t values[kind_count]{};
+			bool valid[kind_count]{};
+			// multiplexed, values are estimates
+			bool scaled{};
+
+			bool has(kind which_) const noexcept { return valid[which_]; }
+			std::uint64_t operator[](kind which_) const noexcept { return values[which_]; }
+
+			// instructions per cycle, 0 if not known
+			double ipc() const noexcept
+			{
+				return (has(instructions) && has(cycles) && values[cycles] > 0)
+						   ? double(values[instructions]) / double(values[cycles])
+						   : 0.0;
+			}
+
+			void print(FILE* out_, const char* title_) const noexcept
+			{
+				::fprintf(out_, "\n%-24s %12.3f us", title_, elapsed_ns / 1000.0);
+				for (unsigned k = 0; k < kind_count; ++k)
+				{
+					if (valid[k])
+						::fprintf(out_, "  %s: %llu", names[k], (unsigned long long)values[k]);
+					else
+						::fprintf(out_, "  %s: n/a", names[k]);
+				}
+				if (ipc() > 0)
+					::fprintf(out_, "  IPC: %.2f", ipc());
+				if (scaled)
+					::fprintf(out_, "  (scaled)");
+			}
+		};
+
+	private:
+		// the group leader is the first one opened
+		int leader_{-1};
+		int fds_[kind_count]{-1, -1, -1, -1};
+		// the position in the group read, per kind
+		int slot_[kind_count]{-1, -1, -1, -1};
+		unsigned opened_{};
+		std::uint64_t start_ticks_{};
+
+#ifdef DBJ_PERF_COUNTERS_LINUX
+		static int open_one(std::uint64_t config_, int group_) noexcept
+		{
+			perf_event_attr attr_{};
+			std::memset(&attr_, 0, sizeof(attr_));
+			attr_.size = sizeof(attr_);
+			attr_.type = PERF_TYPE_HARDWARE;
+			attr_.config = config_;
+			attr_.disabled = group_ < 0 ? 1 : 0;
+			// user mode only, that is what paranoid 2 allows
+			attr_.exclude_kernel = 1;
+			attr_.exclude_hv = 1;
+			attr_.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+			// this thread, any cpu
+			return int(::syscall(SYS_perf_event_open, &attr_, 0, -1, group_, 0));
+		}
+
+		void open_all() noexcept
+		{
+			static constexpr std::uint64_t configs_[kind_count]{
+				PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CPU_CYCLES,
+				PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+
+			for (unsigned k = 0; k < kind_count; ++k)
+			{
+				const int fd_ = open_one(configs_[k], leader_);
+				// DBJ NOTE: not all of them exist everywhere, the rest is still useful
+				if (fd_ < 0)
+					continue;
+				if (leader_ < 0)
+					leader_ = fd_;
+				fds_[k] = fd_;
+				slot_[k] = int(opened_++);
+			}
+		}
+
+		void close_all() noexcept
+		{
+			for (int& fd_ : fds_)
+				if (fd_ >= 0)
+				{
+					::close(fd_);
+					fd_ = -1;
+				}
+			leader_ = -1;
+			opened_ = 0;
+		}
+#endif // DBJ_PERF_COUNTERS_LINUX
+
+	public:
+		// opens and starts
+		counters() noexcept
+		{
+#ifdef DBJ_PERF_COUNTERS_LINUX
+			open_all();
+#endif
+			start();
+		}
+
+		~counters()
+		{
+#ifdef DBJ_PERF_COUNTERS_LINUX
+			close_all();
+#endif
+		}
+
+		counters(counters const&) = delete;
+		counters& operator=(counters const&) = delete;
+
+		// false means time only
+		bool is_counting() const noexcept { return leader_ >= 0; }
+
+		// zero and start again
+		void start() noexcept
+		{
+#ifdef DBJ_PERF_COUNTERS_LINUX
+			if (leader_ >= 0)
+			{
+				::ioctl(leader_, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+				::ioctl(leader_, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+			}
+#endif
+			start_ticks_ = tsc::start_ticks();
+		}
+
+		// stops the counting, start() to count again
+		sample stop() noexcept
+		{
+			sample retval_{};
+			const std::uint64_t stop_ticks_ = tsc::stop_ticks();
+#ifdef DBJ_PERF_COUNTERS_LINUX
+			if (leader_ >= 0)
+			{
+				::ioctl(leader_, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+
+				// nr, time enabled, time running, values
+				std::uint64_t buffer_[3 + kind_count]{};
+				const ssize_t read_ = ::read(leader_, buffer_, sizeof(buffer_));
+				if (read_ >= ssize_t(3 * sizeof(std::uint64_t)) && buffer_[0] == opened_)
+				{
+					const std::uint64_t enabled_ = buffer_[1];
+					const std::uint64_t running_ = buffer_[2];
+					const double scale_ = (running_ > 0 && running_ < enabled_) ? double(enabled_) / double(running_) : 1.0;
+					retval_.scaled = scale_ != 1.0;
+					for (unsigned k = 0; k < kind_count; ++k)
+					{
+						if (slot_[k] < 0 || running_ == 0)
+							continue;
+						retval_.values[k] = std::uint64_t(double(buffer_[3 + slot_[k]]) * scale_);
+						retval_.valid[k] = true;
+					}
+				}
+			}
+#endif
+			retval_.elapsed_ns = double(stop_ticks_ - start_ticks_) * tsc::calibrated().ns_per_tick;
+			return retval_;
+		}
+	}; // counters
+
+} // namespace dbj::stopwatch
+
+#ifdef DBJ_PERF_COUNTERS_TESTING
+/*
+the sequential and the random walk over the same array, the same
+instructions, very different cache misses
+
+	clang++ -std=c++17 -O2 -DDBJ_PERF_COUNTERS_TESTING -x c++ nonstd/dbj_perf_counters.h
+*/
+#include <vector>
+
+int main()
+{
+	using dbj::stopwatch::counters;
+
+	const std::size_t size_ = std::size_t(1) << 22;
+	std::vector<std::uint32_t> next_(size_);
+	// sequential ring, and the random ring, the same loop walks both
+	for (std::size_t k = 0; k < size_; ++k)
+		next_[k] = std::uint32_t((k + 1) % size_);
+
+	auto walk_ = [&] {
+		std::uint32_t at_ = 0;
+		for (std::size_t k = 0; k < size_; ++k)
+			at_ = next_[at_];
+		return at_;
+	};
+
+	counters counters_{};
+	::printf("\nperf counters: %s", counters_.is_counting() ? "available" : "not available, time only");
+
+	counters_.start();
+	volatile std::uint32_t sink_ = walk_();
+	counters_.stop().print(stdout, "sequential walk");
+
+	// Sattolo, one cycle over all the elements
+	std::uint64_t random_ = 88172645463325252ull;
+	for (std::size_t k = size_ - 1; k > 0; --k)
+	{
+		random_ ^= random_ << 13, random_ ^= random_ >> 7, random_ ^= random_ << 17;
+		const std::size_t j_ = std::size_t(random_ % k);
+		const std::uint32_t swap_ = next_[k];
+		next_[k] = next_[j_];
+		next_[j_] = swap_;
+	}
+
+	counters_.start();
+	sink_ = walk_();
+	counters_.stop().print(stdout, "random walk");
+	(void)sink_;
+	::printf("\n");
+	return 0;
+}
+#endif // DBJ_PERF_COUNTERS_TESTING
+
+#endif // DBJ_PERF_COUNTERS_INC_
@@ -9,9 +9,47 @@
 /// #include <iostream>
 #include <array>
 #include <cassert>
+#include <charconv>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <string_view>
+#include <type_traits>
+
+// the whole sequence goes to the same place as DBJ_PRINT
+#ifdef DBJ_ASYNC_PRINT
+#include "../dbj_async_log.h"
+#endif // DBJ_ASYNC_PRINT
+
+// default cap of the elements shown, 0 is all of them
+#ifndef DBJ_SEQUENCE_PRINT_MAX
+#define DBJ_SEQUENCE_PRINT_MAX 0
+#endif
+
+#undef DBJ_SEQUENCE_PRINT_FAIL_POLICY
+// redefine this to return instead of exit() if required
+#define DBJ_SEQUENCE_PRINT_FAIL_POLICY( MSG_) \
+perror( " (" __FILE__ ") " MSG_ ); \
+exit(EXIT_FAILURE);
 
 // (c) 2019/2020 by dbj@dbj.org
 // Licence https://dbj.org/license_dbj
+/*
+2021 DBJ NOTE: was one DBJ_PRINT per element and per delimiter, each one
+the stdio call, thousands of them for the big container. now the whole
+sequence is rendered into one buffer and written with one call.
+
+    dbj::sequence_print(vector_);              // all the elements
+    dbj::sequence_print(vector_, true, dbj::default_delimiters, 16);  // first 16
+
+    // or just render it, no printing
+    dbj::sequence_buffer buffer_;
+    dbj::sequence_render(buffer_, begin(vector_), end(vector_));
+
+elements can be bool, char, integers, floating points and strings.
+numbers are std::to_chars, floating points the shortest round trip form.
+*/
 namespace dbj {
 
     // dc == delimiter code
@@ -21,40 +59,169 @@ namespace dbj {
 
     using delimiters_function = char (*)(dc);
 
-    // print a sequence
+    // on the stack until it grows bigger
+    class sequence_buffer final
+    {
+        char local_[512]{};
+        char* data_ = local_;
+        std::size_t size_{};
+        std::size_t capacity_ = sizeof(local_);
+
+    public:
+        sequence_buffer() noexcept = default;
+        ~sequence_buffer() { if (data_ != local_) ::free(data_); }
+
+        sequence_buffer(sequence_buffer const&) = delete;
+        sequence_buffer& operator=(sequence_buffer const&) = delete;
+
+        const char* data() const noexcept { return data_; }
+        std::size_t size() const noexcept { return size_; }
+        void clear() noexcept { size_ = 0; }
+
+        // returns where to write extra_ chars
+        char* reserve(std::size_t extra_) noexcept
+        {
+            if (size_ + extra_ <= capacity_)
+                return data_ + size_;
+
+            std::size_t new_capacity_ = capacity_ * 2;
+            while (new_capacity_ < size_ + extra_)
+                new_capacity_ *= 2;
+
+            char* new_data_ = nullptr;
+            if (data_ == local_) {
+                new_data_ = (char*)::malloc(new_capacity_);
+                if (new_data_) std::memcpy(new_data_, local_, size_);
+            }
+            else {
+                new_data_ = (char*)::realloc(data_, new_capacity_);
+            }
+            if (!new_data_) {
+                DBJ_SEQUENCE_PRINT_FAIL_POLICY("sequence_buffer::reserve() - memory allocation failure");
+            }
+            data_ = new_data_;
+            capacity_ = new_capacity_;
+            return data_ + size_;
+        }
+
+        // after reserve()
+        void commit(std::size_t written_) noexcept { size_ += written_; }
+
+        void append(const char* text_, std::size_t length_) noexcept
+        {
+            std::memcpy(reserve(length_), text_, length_);
+            size_ += length_;
+        }
+
+        void append(char char_) noexcept
+        {
+            *reserve(1) = char_;
+            size_ += 1;
+        }
+    };
+
+    namespace detail {
+        // enough for any integer and the shortest double
+        constexpr std::size_t sequence_number_max = 32;
+
+        template<typename T>
+        inline void render_element(sequence_buffer& buffer_, T const& element_) noexcept
+        {
+            using type = std::decay_t<T>;
+            if constexpr (std::is_same_v<type, bool>) {
+                if (element_) buffer_.append("true", 4); else buffer_.append("false", 5);
+            }
+            else if constexpr (std::is_same_v<type, char>) {
+                buffer_.append(element_);
+            }
+            else if constexpr (std::is_arithmetic_v<type>) {
+                char* at_ = buffer_.reserve(sequence_number_max);
+                const std::to_chars_result result_ = std::to_chars(at_, at_ + sequence_number_max, element_);
+                buffer_.commit(std::size_t(result_.ptr - at_));
+            }
+            else if constexpr (std::is_convertible_v<type const&, std::string_view>) {
+                const std::string_view view_ = element_;
+                buffer_.append(view_.data(), view_.size());
+            }
+            else {
+                static_assert(std::is_arithmetic_v<type>,
+                    "dbj::sequence_print -- element type can not be rendered");
+            }
+        }
+
+        // the " , ... N more" after the capped elements
+        constexpr std::size_t sequence_tail_max = sequence_number_max + 32;
+    } // detail
+
+    // render a sequence
     // arguments are two iterators
     // pointing to it
+    // max_elements_ 0 is all of them
     template<typename Iterator >
-    inline void sequence_print(
-        Iterator begin_, 
-        Iterator end_, 
-        delimiters_function delimiters, 
-        bool show_size) 
+    inline void sequence_render(
+        sequence_buffer& buffer_,
+        Iterator begin_,
+        Iterator end_,
+        delimiters_function delimiters = default_delimiters,
+        bool show_size = true,
+        std::size_t max_elements_ = DBJ_SEQUENCE_PRINT_MAX)
     {
         using namespace std;
-        auto size_ = [&] { return  size_t(distance(begin_, end_));  };
+        const size_t size_ = size_t(distance(begin_, end_));
         if (show_size) {
-            DBJ_PRINT( " sequence " , delimiters(dc::LEFT_SQ_BRACE) , "size:" , size_() , delimiters(dc::RIGHT_SQ_BRACE));
+            buffer_.append(" sequence ", 10);
+            buffer_.append(delimiters(dc::LEFT_SQ_BRACE));
+            buffer_.append("size:", 5);
+            detail::render_element(buffer_, size_);
+            buffer_.append(delimiters(dc::RIGHT_SQ_BRACE));
         }
-        log( delimiters(dc::SPACE) , delimiters(dc::LEFT_BRACE));
+        buffer_.append(delimiters(dc::SPACE));
+        buffer_.append(delimiters(dc::LEFT_BRACE));
+
+        const size_t shown_ = (max_elements_ > 0 && max_elements_ < size_) ? max_elements_ : size_;
         auto walker = begin_;
-        if (walker != end_)
+        for (size_t k = 0; k < shown_; ++k, ++walker)
         {
             // first sequence element
             // no leading comma
-            DBJ_PRINT( delimiters(dc::SPACE) , *walker);
-            walker++;
-            // other elements, if any
-             // with a leading comma
-            while (walker != end_) {
-                DBJ_PRINT( delimiters(dc::SPACE) , delimiters(dc::COMMA) , delimiters(dc::SPACE) , *walker);
-                // operator '++' advances the iterator
-                // logically to the 'right'
-                // see the diagram below
-                walker++;
+            if (k > 0) {
+                buffer_.append(delimiters(dc::SPACE));
+                buffer_.append(delimiters(dc::COMMA));
             }
+            buffer_.append(delimiters(dc::SPACE));
+            detail::render_element(buffer_, *walker);
+        }
+
+        if (shown_ < size_) {
+            // capped, say how many are not shown
+            char* at_ = buffer_.reserve(detail::sequence_tail_max);
+            const int written_ = std::snprintf(at_, detail::sequence_tail_max, "%c%c%c... %zu more",
+                delimiters(dc::SPACE), delimiters(dc::COMMA), delimiters(dc::SPACE), size_ - shown_);
+            if (written_ > 0) buffer_.commit(size_t(written_) < detail::sequence_tail_max ? size_t(written_) : detail::sequence_tail_max - 1);
         }
-        DBJ_PRINT( delimiters(dc::SPACE) , delimiters(dc::RIGHT_BRACE));
+        buffer_.append(delimiters(dc::SPACE));
+        buffer_.append(delimiters(dc::RIGHT_BRACE));
+    }
+
+    // print a sequence
+    // arguments are two iterators
+    // pointing to it
+    // one write, to stderr as DBJ_PRINT
+    template<typename Iterator >
+    inline void sequence_print(
+        Iterator begin_,
+        Iterator end_,
+        delimiters_function delimiters,
+        bool show_size,
+        std::size_t max_elements_ = DBJ_SEQUENCE_PRINT_MAX)
+    {
+        sequence_buffer buffer_;
+        sequence_render(buffer_, begin_, end_, delimiters, show_size, max_elements_);
+#ifdef DBJ_ASYNC_PRINT
+        // what was printed before comes before
+        ::dbj::async_log::flush();
+#endif // DBJ_ASYNC_PRINT
+        ::fwrite(buffer_.data(), 1, buffer_.size(), stderr);
     }
 
     // print a sequence with a comma in between elements
@@ -65,14 +232,47 @@ namespace dbj {
     inline void sequence_print(
         Sequence const& seq_,
         bool show_size = true,
-        delimiters_function delimiters = default_delimiters
+        delimiters_function delimiters = default_delimiters,
+        std::size_t max_elements_ = DBJ_SEQUENCE_PRINT_MAX
     ) {
         using namespace std;
-        sequence_print(begin(seq_), end(seq_), delimiters, show_size);
+        sequence_print(begin(seq_), end(seq_), delimiters, show_size, max_elements_);
     }
 
 } // dbj
 
+#undef DBJ_SEQUENCE_PRINT_FAIL_POLICY
+
+#ifdef DBJ_SEQUENCE_PRINT_TESTING
+/*
+one write per sequence, try it under strace -e write
+
+    clang++ -std=c++17 -O2 -DDBJ_SEQUENCE_PRINT_TESTING -x c++ nonstd/dbj_sequence_print.h
+*/
+#include <string>
+#include <vector>
+
+int main()
+{
+    std::vector<int> ints_(10000);
+    for (int k = 0; k < int(ints_.size()); ++k) ints_[k] = k * 7 - 3000;
+    dbj::sequence_print(ints_, true, dbj::default_delimiters, 8);
+    ::fputc('\n', stderr);
+
+    const double doubles_[]{ 0.1, 1.5, -2.25e-10, 3.0 };
+    dbj::sequence_print(doubles_);
+    ::fputc('\n', stderr);
+
+    const std::string strings_[]{ "one", "two", "three" };
+    dbj::sequence_print(strings_, false);
+    ::fputc('\n', stderr);
 
+    dbj::sequence_buffer buffer_;
+    dbj::sequence_render(buffer_, std::begin(ints_), std::end(ints_));
+    assert(buffer_.size() > ints_.size() * 4);
+    ::fprintf(stderr, "all of them rendered: %zu chars\n", buffer_.size());
+    return 0;
+}
+#endif // DBJ_SEQUENCE_PRINT_TESTING
 
 #endif // !DBJ_SEQUENCE_PRINT_INC
@@ -10,6 +10,26 @@
 #include <array>
 #include <chrono>
 #include <atomic>
+#include <cstdint>
+#include <cstdio>
+
+// x86 time stamp counter, see stopwatch::cycles
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define DBJ_TIMER_HAS_TSC 1
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#include <x86intrin.h>
+#endif
+#else
+#define DBJ_TIMER_HAS_TSC 0
+#endif
+
+// how long is the tsc measured against the steady_clock, once per process
+#ifndef DBJ_TSC_CALIBRATION_MS
+#define DBJ_TSC_CALIBRATION_MS 10
+#endif
 
 namespace dbj {
 
@@ -54,6 +74,186 @@ namespace stopwatch
 	using precise = engine<>;
 	using system = engine<std::chrono::system_clock>;
 	using monotonic = engine<std::chrono::steady_clock>;
+
+	/*
+	the time stamp counter, the cpu cycles
+
+	rdtsc is a few nanoseconds, clock::now() is tens of them. for timing the
+	short kernels that matters.
+
+	only the invariant tsc is used, the one ticking at the constant rate
+	regardless of the power states and the same on all the cores. it is
+	measured against the steady_clock once, on the first use. where there
+	is no invariant tsc, or no x86, the ticks are steady_clock nanoseconds.
+
+	stopwatch::cycles stopwatch{};
+	// ... the kernel ...
+	auto ticks_ = stopwatch.elapsed_ticks();
+	auto nanos_ = stopwatch.elapsed();
+	auto micros_ = stopwatch.elapsed<double, std::chrono::duration<double, std::micro>>();
+	*/
+	namespace tsc
+	{
+		// cpuid leaf 0x80000007, edx bit 8
+		inline bool is_invariant() noexcept
+		{
+#if DBJ_TIMER_HAS_TSC
+#ifdef _MSC_VER
+			int regs_[4]{};
+			__cpuid(regs_, 0x80000000);
+			if (unsigned(regs_[0]) < 0x80000007u)
+				return false;
+			__cpuid(regs_, 0x80000007);
+			return (regs_[3] & (1 << 8)) != 0;
+#else
+			unsigned eax_{}, ebx_{}, ecx_{}, edx_{};
+			if (!__get_cpuid(0x80000007u, &eax_, &ebx_, &ecx_, &edx_))
+				return false;
+			return (edx_ & (1u << 8)) != 0;
+#endif
+#else
+			return false;
+#endif
+		}
+
+		inline std::uint64_t steady_ns() noexcept
+		{
+			return static_cast<std::uint64_t>(
+				std::chrono::duration_cast<std::chrono::nanoseconds>(
+					std::chrono::steady_clock::now().time_since_epoch())
+					.count());
+		}
+
+#if DBJ_TIMER_HAS_TSC
+		// lfence before, the previous instructions are done
+		// lfence after, the measured ones do not start before
+		inline std::uint64_t read_start() noexcept
+		{
+			_mm_lfence();
+			const std::uint64_t ticks_ = __rdtsc();
+			_mm_lfence();
+			return ticks_;
+		}
+
+		// rdtscp waits for the measured ones to finish
+		// lfence after, the following ones do not start before
+		inline std::uint64_t read_stop() noexcept
+		{
+			unsigned int aux_{};
+			const std::uint64_t ticks_ = __rdtscp(&aux_);
+			_mm_lfence();
+			return ticks_;
+		}
+#endif // DBJ_TIMER_HAS_TSC
+
+		struct calibration final
+		{
+			// false means the ticks are steady_clock nanoseconds
+			bool is_tsc{};
+			double ns_per_tick{1.0};
+			double ticks_per_ns{1.0};
+		};
+
+		inline calibration calibrate() noexcept
+		{
+			calibration retval_{};
+#if DBJ_TIMER_HAS_TSC
+			if (!is_invariant())
+				return retval_;
+
+			// DBJ NOTE: spin, not sleep, so the core does not go to the deep sleep
+			const std::uint64_t window_ns_ = std::uint64_t(DBJ_TSC_CALIBRATION_MS) * 1000000u;
+			const std::uint64_t ns_begin_ = steady_ns();
+			const std::uint64_t tsc_begin_ = read_start();
+			std::uint64_t ns_end_{};
+			do
+			{
+				ns_end_ = steady_ns();
+			} while (ns_end_ - ns_begin_ < window_ns_);
+			const std::uint64_t tsc_end_ = read_stop();
+
+			if (tsc_end_ <= tsc_begin_)
+				return retval_;
+
+			retval_.is_tsc = true;
+			retval_.ns_per_tick = double(ns_end_ - ns_begin_) / double(tsc_end_ - tsc_begin_);
+			retval_.ticks_per_ns = 1.0 / retval_.ns_per_tick;
+#endif // DBJ_TIMER_HAS_TSC
+			return retval_;
+		}
+
+		// once per process, on the first call
+		// call it at the start of main() so that the first stopwatch does not wait
+		inline calibration const& calibrated() noexcept
+		{
+			static const calibration calibration_ = calibrate();
+			return calibration_;
+		}
+
+		/*
+		ticks of the calibrated clock, no fences
+		for the time stamps, not for timing the short kernels
+		*/
+		inline std::uint64_t now_ticks() noexcept
+		{
+#if DBJ_TIMER_HAS_TSC
+			if (calibrated().is_tsc)
+				return __rdtsc();
+#endif
+			return steady_ns();
+		}
+
+		// ticks of the calibrated clock, fenced, for the start of the measurement
+		inline std::uint64_t start_ticks() noexcept
+		{
+#if DBJ_TIMER_HAS_TSC
+			if (calibrated().is_tsc)
+				return read_start();
+#endif
+			return steady_ns();
+		}
+
+		// and for the stop
+		inline std::uint64_t stop_ticks() noexcept
+		{
+#if DBJ_TIMER_HAS_TSC
+			if (calibrated().is_tsc)
+				return read_stop();
+#endif
+			return steady_ns();
+		}
+	} // namespace tsc
+
+	class cycles
+	{
+		// must be initialized before the start point
+		const tsc::calibration& calibration_ = tsc::calibrated();
+		const std::uint64_t start_point{};
+
+	public:
+		cycles() noexcept : start_point(tsc::start_ticks())
+		{
+		}
+
+		// true if the ticks are cpu cycles
+		bool is_tsc() const noexcept { return calibration_.is_tsc; }
+
+		// cpu cycles, or nanoseconds if not is_tsc()
+		std::uint64_t elapsed_ticks() const noexcept
+		{
+			return tsc::stop_ticks() - start_point;
+		}
+
+		template <
+			typename REP = std::chrono::nanoseconds::rep,
+			typename UNITS = std::chrono::nanoseconds>
+		REP elapsed() const noexcept
+		{
+			const std::chrono::duration<double, std::nano> nanos_(
+				double(elapsed_ticks()) * calibration_.ns_per_tick);
+			return static_cast<REP>(std::chrono::duration_cast<UNITS>(nanos_).count());
+		}
+	};
 } // namespace stopwatch
 
 /*
@@ -126,5 +326,53 @@ struct timer final
 
 } // namespace dbj 
 
+#ifdef DBJ_TIMER_TESTING
+/*
+the tsc calibration and the cost of one elapsed() call, per engine
+
+	clang++ -std=c++17 -O2 -DDBJ_TIMER_TESTING -x c++ nonstd/dbj_timer.h
+*/
+namespace dbj::timer_testing
+{
+	// nanoseconds per elapsed() call
+	template <typename ENGINE>
+	inline double call_cost(const char* title_, unsigned count_ = 1000000)
+	{
+		stopwatch::monotonic outer_{};
+		ENGINE engine_{};
+		std::uint64_t sink_{};
+		for (unsigned k = 0; k < count_; ++k)
+			sink_ += static_cast<std::uint64_t>(engine_.elapsed());
+		const double cost_ = double(outer_.elapsed()) / count_;
+		std::printf("\n%-24s %8.3f ns per elapsed() %s", title_, cost_, sink_ ? "" : " ");
+		return cost_;
+	}
+} // namespace dbj::timer_testing
+
+int main()
+{
+	using namespace dbj;
+	const auto& calibration_ = stopwatch::tsc::calibrated();
+	std::printf("\ninvariant tsc: %s, %.4f ticks per ns",
+				calibration_.is_tsc ? "yes" : "no", calibration_.ticks_per_ns);
+
+	timer_testing::call_cost<stopwatch::precise>("stopwatch::precise");
+	timer_testing::call_cost<stopwatch::monotonic>("stopwatch::monotonic");
+	timer_testing::call_cost<stopwatch::cycles>("stopwatch::cycles");
+
+	// cycles against steady_clock, over 50 ms
+	stopwatch::monotonic steady_{};
+	stopwatch::cycles cycles_{};
+	while (steady_.elapsed<long long, std::chrono::milliseconds>() < 50)
+	{
+	}
+	const auto cycles_ns_ = cycles_.elapsed();
+	const auto steady_ns_ = steady_.elapsed();
+	std::printf("\n50 ms by cycles: %lld ns, by steady_clock: %lld ns\n",
+				(long long)cycles_ns_, (long long)steady_ns_);
+	return 0;
+}
+#endif // DBJ_TIMER_TESTING
+
 #endif // DBJ_TIMER_INC_
 
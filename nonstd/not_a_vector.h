@@ -96,6 +96,7 @@ class not_a_vector {
 
   const T *const data(void) const noexcept { return this->arr_; }
   T *const data(void) noexcept { return this->arr_; }
+  size_t size(void) const noexcept { return this->size_; }
 
   // change value functions
   void push_back(/*const*/ T value) {
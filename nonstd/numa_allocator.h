@@ -0,0 +1,416 @@
+#ifndef DBJ_NUMA_ALLOCATOR_INC_
+#define DBJ_NUMA_ALLOCATOR_INC_
+#ifdef __clang__
+#pragma clang system_header
+#endif // __clang__
+
+/*
+ (c) 2021 by dbj.org   -- LICENSE DBJ -- https://dbj.org/license_dbj/
+
+ NUMA aware aligned allocation
+
+ on the machine with several NUMA nodes, memory is by default placed on the
+ node of the thread which touches it first. numa_allocator gives the control
+ over that:
+
+	using namespace dbj::alloc;
+
+	// all on node 1
+	std::vector<float, numa_allocator<float>> near_( numa_allocator<float>( numa_placement::on_node(1) ) );
+
+	// pages spread round robin over all the nodes
+	numa_vector<float> spread_( numa_allocator<float>( numa_placement::interleaved() ) );
+
+ Linux only, through the raw mbind / set_mempolicy / get_mempolicy syscalls,
+ no libnuma required. Allocations are page granular, mmap-ed, thus meant
+ for the large buffers.
+
+ It degrades gracefully: on the single node machine, on non Linux builds, or
+ if the syscalls are not permitted (containers), the placement is ignored and
+ it is just the page aligned allocator. Thus it is testable anywhere.
+*/
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "aligned_allocator.h"
+
+#if defined(__linux__)
+#define DBJ_NUMA_LINUX 1
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#else
+#define DBJ_NUMA_LINUX 0
+#endif
+
+#undef DBJ_NUMA_FAIL_POLICY
+// redefine this to return instead of exit() if required
+#define DBJ_NUMA_FAIL_POLICY( MSG_) \
+perror( " (" __FILE__ ") " MSG_ ); \
+exit(EXIT_FAILURE);
+
+namespace dbj::alloc
+{
+	enum class numa_policy
+	{
+		local,     // first touch, the OS default
+		bind,      // only on the given node
+		interleave // round robin over all the allowed nodes
+	};
+
+	struct numa_placement final
+	{
+		numa_policy policy{numa_policy::local};
+		int node{};
+
+		static constexpr numa_placement local() noexcept { return {numa_policy::local, 0}; }
+		static constexpr numa_placement on_node(int node_) noexcept { return {numa_policy::bind, node_}; }
+		static constexpr numa_placement interleaved() noexcept { return {numa_policy::interleave, 0}; }
+
+		friend constexpr bool operator==(numa_placement const& left_, numa_placement const& right_) noexcept
+		{
+			return left_.policy == right_.policy && left_.node == right_.node;
+		}
+		friend constexpr bool operator!=(numa_placement const& left_, numa_placement const& right_) noexcept
+		{
+			return !(left_ == right_);
+		}
+	};
+
+	namespace numa
+	{
+		// linux/mempolicy.h values
+		// not included since it is not always installed
+		enum : int
+		{
+			mpol_default = 0,
+			mpol_preferred = 1,
+			mpol_bind = 2,
+			mpol_interleave = 3,
+			mpol_f_mems_allowed = (1 << 2)
+		};
+
+		constexpr inline std::size_t max_nodes = 1024;
+		constexpr inline std::size_t mask_words = max_nodes / (8 * sizeof(unsigned long));
+
+		struct node_mask final
+		{
+			unsigned long bits[mask_words]{};
+
+			void set(std::size_t node_) noexcept
+			{
+				bits[node_ / (8 * sizeof(unsigned long))] |= (1UL << (node_ % (8 * sizeof(unsigned long))));
+			}
+
+			bool test(std::size_t node_) const noexcept
+			{
+				return 0 != (bits[node_ / (8 * sizeof(unsigned long))] & (1UL << (node_ % (8 * sizeof(unsigned long)))));
+			}
+
+			std::size_t count() const noexcept
+			{
+				std::size_t count_{};
+				for (std::size_t node_ = 0; node_ < max_nodes; ++node_)
+					count_ += test(node_) ? 1 : 0;
+				return count_;
+			}
+		};
+
+		/*
+		nodes this process is allowed to use
+		empty if that can not be found
+		*/
+		inline node_mask const& allowed_nodes() noexcept
+		{
+			static const node_mask mask_ = []() noexcept {
+				node_mask retval_{};
+#if DBJ_NUMA_LINUX && defined(SYS_get_mempolicy)
+				int mode_{};
+				if (0 != syscall(SYS_get_mempolicy, &mode_, retval_.bits, max_nodes, nullptr, mpol_f_mems_allowed))
+					return node_mask{};
+#endif
+				return retval_;
+			}();
+			return mask_;
+		}
+
+		// 1 on the single node machine and when NUMA is not available
+		inline std::size_t node_count() noexcept
+		{
+			static const std::size_t count_ = [] {
+				std::size_t allowed_ = allowed_nodes().count();
+				return allowed_ > 0 ? allowed_ : std::size_t(1);
+			}();
+			return count_;
+		}
+
+		// is there any point in asking for the placement
+		inline bool available() noexcept { return node_count() > 1; }
+
+		/*
+		translate the placement to the syscall mode and mask
+		returns false if it has to be ignored
+		*/
+		inline bool make_policy(numa_placement placement_, int& mode_, node_mask& mask_) noexcept
+		{
+			if (!available())
+				return false;
+
+			switch (placement_.policy)
+			{
+			case numa_policy::bind:
+				if (placement_.node < 0 || std::size_t(placement_.node) >= max_nodes ||
+					!allowed_nodes().test(std::size_t(placement_.node)))
+					return false;
+				mode_ = mpol_bind;
+				mask_ = node_mask{};
+				mask_.set(std::size_t(placement_.node));
+				return true;
+			case numa_policy::interleave:
+				mode_ = mpol_interleave;
+				mask_ = allowed_nodes();
+				return true;
+			default:
+				return false;
+			}
+		}
+
+		/*
+		set the policy of the calling thread, for all its future allocations
+		false if ignored or not permitted
+		*/
+		inline bool set_thread_policy(numa_placement placement_) noexcept
+		{
+#if DBJ_NUMA_LINUX && defined(SYS_set_mempolicy)
+			if (placement_.policy == numa_policy::local)
+				return 0 == syscall(SYS_set_mempolicy, int(mpol_default), nullptr, 0UL);
+
+			int mode_{};
+			node_mask mask_{};
+			if (!make_policy(placement_, mode_, mask_))
+				return false;
+			return 0 == syscall(SYS_set_mempolicy, mode_, mask_.bits, (unsigned long)(max_nodes + 1));
+#else
+			(void)placement_;
+			return false;
+#endif
+		}
+
+		inline std::size_t round_to_pages(std::size_t bytes_) noexcept
+		{
+			return (bytes_ + page_size - 1) & ~(page_size - 1);
+		}
+
+		/*
+		page aligned, page granular, placed as asked if possible
+		nullptr on failure
+		*/
+		inline void* allocate(std::size_t bytes_, numa_placement placement_) noexcept
+		{
+			bytes_ = round_to_pages(bytes_ ? bytes_ : 1);
+#if DBJ_NUMA_LINUX
+			void* pv_ = mmap(nullptr, bytes_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+			if (pv_ == MAP_FAILED)
+				return nullptr;
+#if defined(SYS_mbind)
+			int mode_{};
+			node_mask mask_{};
+			if (make_policy(placement_, mode_, mask_))
+			{
+				// pages are not yet touched, thus nothing to move
+				// failure here is not fatal, it is just the default placement
+				(void)syscall(SYS_mbind, pv_, (unsigned long)bytes_, mode_, mask_.bits, (unsigned long)(max_nodes + 1), 0U);
+			}
+#endif
+			return pv_;
+#else
+			(void)placement_;
+			return aligned_malloc(bytes_, page_size);
+#endif
+		}
+
+		inline void deallocate(void* pv_, std::size_t bytes_) noexcept
+		{
+			if (pv_ == nullptr)
+				return;
+#if DBJ_NUMA_LINUX
+			munmap(pv_, round_to_pages(bytes_ ? bytes_ : 1));
+#else
+			(void)bytes_;
+			aligned_free(pv_);
+#endif
+		}
+
+		/*
+		first touch initialization
+
+		with the local policy each page lands on the node of the thread
+		which writes to it first. thus initialize in parallel, with the same
+		partitioning the parallel workers will later use:
+
+			float* data_ = ... ;
+			numa::first_touch(data_, count_, [](float & f_, size_t) { f_ = 0; });
+
+		init_ is void (T &, size_t index)
+		*/
+		template <typename T, typename F>
+		inline void first_touch(T* data_, std::size_t count_, F init_,
+								std::size_t threads_ = std::thread::hardware_concurrency())
+		{
+			if (threads_ < 1)
+				threads_ = 1;
+			if (threads_ > count_)
+				threads_ = count_ > 0 ? count_ : 1;
+
+			const std::size_t chunk_ = (count_ + threads_ - 1) / threads_;
+
+			auto worker_ = [&](std::size_t begin_) {
+				const std::size_t end_ = (begin_ + chunk_ < count_) ? begin_ + chunk_ : count_;
+				for (std::size_t idx_ = begin_; idx_ < end_; ++idx_)
+					init_(data_[idx_], idx_);
+			};
+
+			std::vector<std::thread> workers_;
+			workers_.reserve(threads_ - 1);
+			for (std::size_t t_ = 1; t_ < threads_; ++t_)
+				workers_.emplace_back(worker_, t_ * chunk_);
+			// the calling thread does the first chunk
+			worker_(0);
+			for (auto& thread_ : workers_)
+				thread_.join();
+		}
+	} // namespace numa
+
+	template <typename T>
+	struct numa_allocator
+	{
+		static_assert(alignof(T) <= page_size, "numa_allocator -- can not align beyond the page size");
+
+		using value_type = T;
+		using size_type = std::size_t;
+		using difference_type = std::ptrdiff_t;
+
+		template <typename U>
+		struct rebind
+		{
+			typedef numa_allocator<U> other;
+		};
+
+		numa_placement placement{};
+
+		numa_allocator() noexcept {}
+		explicit numa_allocator(numa_placement placement_arg_) noexcept : placement(placement_arg_) {}
+
+		template <typename U>
+		numa_allocator(const numa_allocator<U>& other_) noexcept : placement(other_.placement) {}
+
+		static std::size_t max_size() noexcept
+		{
+			return (static_cast<std::size_t>(0) - static_cast<std::size_t>(1)) / sizeof(T);
+		}
+
+		T* allocate(const std::size_t n) const
+		{
+			if (n == 0)
+				return nullptr;
+
+			if (n > max_size())
+			{
+				DBJ_NUMA_FAIL_POLICY("numa_allocator<T>::allocate() - Integer overflow.");
+			}
+
+			void* const pv = numa::allocate(n * sizeof(T), placement);
+
+			if (pv == nullptr)
+			{
+				DBJ_NUMA_FAIL_POLICY("numa_allocator<T>::allocate() - memory allocation failure");
+			}
+
+			return static_cast<T*>(pv);
+		}
+
+		void deallocate(T* const p, const std::size_t n) const noexcept
+		{
+			numa::deallocate(p, n * sizeof(T));
+		}
+
+		template <typename U>
+		friend bool operator==(numa_allocator const& left_, numa_allocator<U> const& right_) noexcept
+		{
+			return left_.placement == right_.placement;
+		}
+
+		template <typename U>
+		friend bool operator!=(numa_allocator const& left_, numa_allocator<U> const& right_) noexcept
+		{
+			return left_.placement != right_.placement;
+		}
+	}; // numa_allocator
+
+	template <typename T>
+	using numa_vector = std::vector<T, numa_allocator<T>>;
+
+} // namespace dbj::alloc
+
+#undef DBJ_NUMA_FAIL_POLICY
+
+#ifdef DBJ_NUMA_TESTING
+/*
+on the single node machine, or in the container, this is the fallback path
+
+	clang++ -std=c++17 -DDBJ_NUMA_TESTING -x c++ nonstd/numa_allocator.h -lpthread
+*/
+#include <cassert>
+
+int main()
+{
+	using namespace dbj::alloc;
+
+	const std::size_t nodes_ = numa::node_count();
+	assert(nodes_ >= 1);
+	::printf("\nnuma nodes: %zu, placement %s", nodes_, numa::available() ? "available" : "ignored");
+
+	// the fallback, nothing to place on a single node, nonexistent node is ignored
+	if (!numa::available())
+	{
+		assert(!numa::set_thread_policy(numa_placement::on_node(0)));
+		assert(!numa::set_thread_policy(numa_placement::interleaved()));
+	}
+	for (numa_placement placement_ : {numa_placement::local(), numa_placement::on_node(0),
+									  numa_placement::on_node(999), numa_placement::interleaved()})
+	{
+		void* pv_ = numa::allocate(3 * page_size + 1, placement_);
+		assert(pv_ && (reinterpret_cast<std::uintptr_t>(pv_) % page_size) == 0);
+		static_cast<char*>(pv_)[4 * page_size - 1] = 'x';
+		numa::deallocate(pv_, 3 * page_size + 1);
+	}
+
+	// first touch over a few threads, each element written exactly once
+	const std::size_t count_ = 100000;
+	numa_allocator<unsigned> allocator_{};
+	unsigned* data_ = allocator_.allocate(count_);
+	numa::first_touch(data_, count_, [](unsigned& value_, std::size_t idx_) { value_ = unsigned(idx_) + 1; }, 4);
+	for (std::size_t k = 0; k < count_; ++k)
+		assert(data_[k] == unsigned(k) + 1);
+	allocator_.deallocate(data_, count_);
+
+	// inside std::vector, the placement travels with the allocator
+	numa_vector<double> spread_{numa_allocator<double>(numa_placement::interleaved())};
+	for (int k = 0; k < 10000; ++k)
+		spread_.push_back(k * 0.5);
+	assert(spread_[9999] == 9999 * 0.5);
+	assert(spread_.get_allocator() == numa_allocator<int>(numa_placement::interleaved()));
+	assert(spread_.get_allocator() != numa_allocator<int>(numa_placement::on_node(0)));
+
+	::printf("\nnuma allocator: all checks passed\n");
+	return 0;
+}
+#endif // DBJ_NUMA_TESTING
+
+#endif // DBJ_NUMA_ALLOCATOR_INC_
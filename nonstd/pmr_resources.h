@@ -0,0 +1,323 @@
+#ifndef DBJ_PMR_RESOURCES_INC_
+#define DBJ_PMR_RESOURCES_INC_
+#ifdef __clang__
+#pragma clang system_header
+#endif // __clang__
+
+/*
+ (c) 2021 by dbj.org   -- LICENSE DBJ -- https://dbj.org/license_dbj/
+
+ dbj allocators as std::pmr::memory_resource implementations
+
+ each dbj allocator has its own interface. wrapped in here they all become
+ std::pmr::memory_resource, so one container type can switch between them
+ at runtime, no template explosion:
+
+	using namespace dbj::alloc::pmr;
+
+	arena request_arena_{};
+	arena_resource arena_res_{request_arena_};
+	stats_resource measured_{arena_res_};
+
+	std::pmr::vector<int> ints_(&measured_);
+	// ... work ...
+	DBJ_PRINT("peak: %zu bytes", measured_.peak_bytes());
+
+ resources in here
+	heap_resource          -- DBJ_MALLOC / DBJ_FREE
+	aligned_resource<A>    -- aligned_allocator<A>
+	arena_resource         -- dbj::alloc::arena
+	stack_resource<N>      -- fixed buffer living where the resource lives
+	stats_resource         -- counts what goes through it to the upstream
+
+ none of them throws. on failure DBJ_PMR_FAIL_POLICY is used, as with the
+ other dbj allocators.
+*/
+
+#if !__has_include(<memory_resource>)
+#error <memory_resource> is required
+#endif
+
+#include <memory_resource>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+
+#include "../dbj_heap_alloc.h"
+#include "aligned_allocator.h"
+#include "arena_allocator.h"
+
+#undef DBJ_PMR_FAIL_POLICY
+// redefine this to return instead of exit() if required
+#define DBJ_PMR_FAIL_POLICY( MSG_) \
+perror( " (" __FILE__ ") " MSG_ ); \
+exit(EXIT_FAILURE);
+
+namespace dbj::alloc::pmr
+{
+	using dbj::alloc::arena;
+
+	/*
+	DBJ_MALLOC / DBJ_FREE as memory_resource
+
+	over aligned requests are served by over allocating and keeping
+	the original pointer just in front of the aligned block
+	*/
+	class heap_resource final : public std::pmr::memory_resource
+	{
+		static bool is_over_aligned(std::size_t alignment_) noexcept
+		{
+			return alignment_ > alignof(std::max_align_t);
+		}
+
+	protected:
+		void* do_allocate(std::size_t bytes_, std::size_t alignment_) override
+		{
+			if (!is_over_aligned(alignment_))
+			{
+				void* ptr_ = DBJ_MALLOC(bytes_ ? bytes_ : 1);
+				if (ptr_ == nullptr)
+				{
+					DBJ_PMR_FAIL_POLICY("heap_resource::allocate() - memory allocation failure");
+				}
+				return ptr_;
+			}
+
+			// DBJ NOTE: the over allocation must not wrap around
+			if (bytes_ > (std::size_t(-1) - alignment_ - sizeof(void*)))
+			{
+				DBJ_PMR_FAIL_POLICY("heap_resource::allocate() - Integer overflow.");
+			}
+
+			void* raw_ = DBJ_MALLOC(bytes_ + alignment_ + sizeof(void*));
+			if (raw_ == nullptr)
+			{
+				DBJ_PMR_FAIL_POLICY("heap_resource::allocate() - memory allocation failure");
+			}
+			std::uintptr_t aligned_ =
+				(reinterpret_cast<std::uintptr_t>(raw_) + sizeof(void*) + alignment_ - 1) & ~(std::uintptr_t(alignment_) - 1);
+			reinterpret_cast<void**>(aligned_)[-1] = raw_;
+			return reinterpret_cast<void*>(aligned_);
+		}
+
+		void do_deallocate(void* ptr_, std::size_t, std::size_t alignment_) override
+		{
+			if (ptr_ == nullptr)
+				return;
+			if (!is_over_aligned(alignment_))
+			{
+				DBJ_FREE(ptr_);
+				return;
+			}
+			DBJ_FREE(static_cast<void**>(ptr_)[-1]);
+		}
+
+		bool do_is_equal(const std::pmr::memory_resource& other_) const noexcept override
+		{
+			// no RTTI here, thus no dynamic_cast
+			// use the one from heap() and this is true
+			return this == &other_;
+		}
+	}; // heap_resource
+
+	/*
+	the process wide instance
+	*/
+	inline heap_resource* heap() noexcept
+	{
+		static heap_resource instance_{};
+		return &instance_;
+	}
+
+	/*
+	aligned_allocator as memory_resource
+	requests are aligned at least to the ALIGNMENT
+	the ones asking for more get what they ask for, in every build
+	*/
+	template <std::size_t ALIGNMENT>
+	class aligned_resource final : public std::pmr::memory_resource
+	{
+		using allocator_type = aligned_allocator<unsigned char, ALIGNMENT>;
+		allocator_type allocator_{};
+
+	protected:
+		void* do_allocate(std::size_t bytes_, std::size_t alignment_) override
+		{
+			if (alignment_ <= ALIGNMENT)
+				return allocator_.allocate(bytes_ ? bytes_ : 1);
+
+			// over aligned, cache_padded<T> through the polymorphic_allocator for example
+			void* ptr_ = aligned_malloc(bytes_ ? bytes_ : 1, alignment_);
+			if (ptr_ == nullptr)
+			{
+				DBJ_PMR_FAIL_POLICY("aligned_resource::allocate() - memory allocation failure");
+			}
+			return ptr_;
+		}
+
+		void do_deallocate(void* ptr_, std::size_t bytes_, std::size_t alignment_) override
+		{
+			if (alignment_ <= ALIGNMENT)
+				allocator_.deallocate(static_cast<unsigned char*>(ptr_), bytes_);
+			else
+				aligned_free(ptr_);
+		}
+
+		bool do_is_equal(const std::pmr::memory_resource& other_) const noexcept override
+		{
+			return this == &other_;
+		}
+	}; // aligned_resource
+
+	/*
+	dbj::alloc::arena as memory_resource
+	deallocate does nothing, use arena::reset()
+	*/
+	class arena_resource final : public std::pmr::memory_resource
+	{
+		arena* arena_{};
+
+	public:
+		explicit arena_resource(arena& arena_arg_) noexcept : arena_(&arena_arg_) {}
+
+		arena& get_arena() const noexcept { return *arena_; }
+
+	protected:
+		void* do_allocate(std::size_t bytes_, std::size_t alignment_) override
+		{
+			return arena_->allocate(bytes_, alignment_);
+		}
+
+		void do_deallocate(void*, std::size_t, std::size_t) override
+		{
+			/* arena::reset() does this */
+		}
+
+		bool do_is_equal(const std::pmr::memory_resource& other_) const noexcept override
+		{
+			return this == &other_;
+		}
+	}; // arena_resource
+
+	/*
+	stack_allocator as memory_resource
+
+	DBJ NOTE: alloca() can not be used behind the virtual call, the memory
+	would be gone as soon as do_allocate() returns. Thus the stack space is
+	the fixed buffer inside the resource itself. Declare the resource
+	on the stack and you have the stack allocator.
+
+	It does not free what was taken. It will exit() on buffer exhaustion,
+	just as stack_allocator does on stack exhaustion.
+	*/
+	template <std::size_t CAPACITY>
+	class stack_resource final : public std::pmr::memory_resource
+	{
+		static_assert(CAPACITY > 0);
+
+		alignas(std::max_align_t) unsigned char buffer_[CAPACITY];
+		std::size_t level_{};
+
+	public:
+		stack_resource() noexcept {}
+
+		std::size_t used() const noexcept { return level_; }
+		constexpr std::size_t capacity() const noexcept { return CAPACITY; }
+		// make it all available again
+		void reset() noexcept { level_ = 0; }
+
+	protected:
+		void* do_allocate(std::size_t bytes_, std::size_t alignment_) override
+		{
+			std::uintptr_t base_ = reinterpret_cast<std::uintptr_t>(buffer_);
+			std::uintptr_t aligned_ = (base_ + level_ + alignment_ - 1) & ~(std::uintptr_t(alignment_) - 1);
+			std::size_t offset_ = static_cast<std::size_t>(aligned_ - base_);
+
+			if (offset_ > CAPACITY || (CAPACITY - offset_) < bytes_)
+			{
+				DBJ_PMR_FAIL_POLICY("stack_resource::allocate() - buffer exhausted");
+			}
+			level_ = offset_ + bytes_;
+			return buffer_ + offset_;
+		}
+
+		void do_deallocate(void*, std::size_t, std::size_t) override
+		{
+			/* do not free stack memory */
+		}
+
+		bool do_is_equal(const std::pmr::memory_resource& other_) const noexcept override
+		{
+			return this == &other_;
+		}
+	}; // stack_resource
+
+	/*
+	sits in front of the upstream resource and measures what goes through
+	the point is to find which resource suits which workload, in production
+	NOTE: counters are not atomic, one stats_resource per thread
+	*/
+	class stats_resource final : public std::pmr::memory_resource
+	{
+		std::pmr::memory_resource* upstream_{};
+
+		std::size_t allocations_{};
+		std::size_t deallocations_{};
+		std::size_t bytes_allocated_{};
+		std::size_t bytes_in_use_{};
+		std::size_t peak_bytes_{};
+
+	public:
+		explicit stats_resource(std::pmr::memory_resource& upstream_arg_) noexcept
+			: upstream_(&upstream_arg_)
+		{
+		}
+
+		std::pmr::memory_resource* upstream() const noexcept { return upstream_; }
+
+		std::size_t allocations() const noexcept { return allocations_; }
+		std::size_t deallocations() const noexcept { return deallocations_; }
+		// total ever requested
+		std::size_t bytes_allocated() const noexcept { return bytes_allocated_; }
+		// requested and not yet given back
+		std::size_t bytes_in_use() const noexcept { return bytes_in_use_; }
+		std::size_t peak_bytes() const noexcept { return peak_bytes_; }
+
+		void clear_stats() noexcept
+		{
+			allocations_ = deallocations_ = 0;
+			bytes_allocated_ = bytes_in_use_ = peak_bytes_ = 0;
+		}
+
+	protected:
+		void* do_allocate(std::size_t bytes_, std::size_t alignment_) override
+		{
+			void* ptr_ = upstream_->allocate(bytes_, alignment_);
+			allocations_ += 1;
+			bytes_allocated_ += bytes_;
+			bytes_in_use_ += bytes_;
+			if (bytes_in_use_ > peak_bytes_)
+				peak_bytes_ = bytes_in_use_;
+			return ptr_;
+		}
+
+		void do_deallocate(void* ptr_, std::size_t bytes_, std::size_t alignment_) override
+		{
+			upstream_->deallocate(ptr_, bytes_, alignment_);
+			deallocations_ += 1;
+			bytes_in_use_ -= bytes_;
+		}
+
+		bool do_is_equal(const std::pmr::memory_resource& other_) const noexcept override
+		{
+			return this == &other_;
+		}
+	}; // stats_resource
+
+} // namespace dbj::alloc::pmr
+
+#undef DBJ_PMR_FAIL_POLICY
+
+#endif // DBJ_PMR_RESOURCES_INC_